@@ -0,0 +1,432 @@
+/*
+ * Measure connection start-up and message round trips, and report them
+ * as JSON so they can be compared across releases.
+ *
+ *	chime-bench --rooms=2 --messages=20 user@example.com <token> > result.json
+ *
+ * It times how long each part of the connection takes to come online,
+ * how long N rooms take to load their members, and for M messages sent
+ * to those rooms (one at a time) both the HTTP response time and the
+ * time until the message comes back to us through juggernaut.
+ *
+ * It posts real messages, so point it at a test room with --room.
+ */
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "chime/chime-connection.h"
+#include "chime/chime-object.h"
+#include "chime/chime-room.h"
+
+#define MESSAGE_TIMEOUT 10
+
+static GMainLoop *loop;
+static int status = EXIT_SUCCESS;
+
+static gchar *opt_server;
+static gchar *opt_room;
+static gint opt_rooms = 1;
+static gint opt_messages = 10;
+static gint opt_timeout = 120;
+
+static GOptionEntry entries[] = {
+	{ "server", 's', 0, G_OPTION_ARG_STRING, &opt_server, "Server URL", "URL" },
+	{ "room", 'r', 0, G_OPTION_ARG_STRING, &opt_room,
+	  "Only use rooms whose name contains this", "NAME" },
+	{ "rooms", 'n', 0, G_OPTION_ARG_INT, &opt_rooms, "Number of rooms to open", "N" },
+	{ "messages", 'm', 0, G_OPTION_ARG_INT, &opt_messages, "Number of messages to send", "M" },
+	{ "timeout", 't', 0, G_OPTION_ARG_INT, &opt_timeout, "Give up after this long", "SECS" },
+	{ NULL }
+};
+
+static ChimeConnection *cxn;
+static gint64 start_time, online_time = -1;
+
+struct bench_room {
+	ChimeRoom *room;
+	gint64 open_start;
+	gulong members_handler, message_handler;
+};
+
+static GPtrArray *rooms;
+static guint rooms_pending;
+static GArray *room_open_ms;
+
+/* The message in flight */
+static guint msg_seq;
+static gchar *msg_text;
+static gint64 msg_start;
+static gboolean msg_sent, msg_echoed;
+static gchar *msg_id;		/* Once the HTTP response has given it */
+static guint msg_deliveries;	/* "message" emissions seen for it */
+static gint64 msg_first_delivery;
+static guint msg_timer;
+static GArray *send_ms, *echo_ms;
+static guint msgs_lost;
+
+static void finish(void);
+static void send_next_message(void);
+
+static gdouble elapsed_ms(gint64 since)
+{
+	return (gdouble)(g_get_monotonic_time() - since) / 1000;
+}
+
+static void collect_room(ChimeConnection *conn, ChimeRoom *room, gpointer ignored)
+{
+	if (rooms->len >= (guint)opt_rooms)
+		return;
+	if (opt_room && !strstr(chime_room_get_name(room), opt_room))
+		return;
+
+	struct bench_room *br = g_new0(struct bench_room, 1);
+	br->room = g_object_ref(room);
+	g_ptr_array_add(rooms, br);
+}
+
+static void free_bench_room(gpointer _br)
+{
+	struct bench_room *br = _br;
+
+	if (br->members_handler)
+		g_signal_handler_disconnect(br->room, br->members_handler);
+	if (br->message_handler)
+		g_signal_handler_disconnect(br->room, br->message_handler);
+	chime_connection_close_room(cxn, br->room);
+	g_object_unref(br->room);
+	g_free(br);
+}
+
+static void message_done(void)
+{
+	if (!msg_sent || !msg_echoed)
+		return;
+
+	g_source_remove(msg_timer);
+	msg_timer = 0;
+	send_next_message();
+}
+
+static void message_echoed(gint64 when)
+{
+	g_array_append_val(echo_ms, (gdouble){ (gdouble)(when - msg_start) / 1000 });
+	msg_echoed = TRUE;
+}
+
+/*
+ * The room's "message" signal fires twice for each message we send: once
+ * from the HTTP response, just before the send completes, and once when
+ * juggernaut delivers it. Only the latter is the echo. Juggernaut may win
+ * the race, so until the send has completed we can't tell which is which.
+ */
+static void on_room_message(ChimeRoom *room, JsonNode *node, gpointer ignored)
+{
+	const gchar *content, *id;
+
+	if (!msg_text || msg_echoed || !parse_string(node, "Content", &content) ||
+	    g_strcmp0(content, msg_text))
+		return;
+	if (msg_id && (!parse_string(node, "MessageId", &id) || strcmp(id, msg_id)))
+		return;
+
+	if (!msg_deliveries++)
+		msg_first_delivery = g_get_monotonic_time();
+
+	/* The response's own emission has already been and gone */
+	if (msg_sent) {
+		message_echoed(g_get_monotonic_time());
+		message_done();
+	}
+}
+
+static void message_sent(GObject *source, GAsyncResult *result, gpointer _seq)
+{
+	GError *error = NULL;
+	JsonNode *node = chime_connection_send_message_finish(CHIME_CONNECTION(source),
+							      result, &error);
+
+	/* Too late; it was already given up on */
+	if (GPOINTER_TO_UINT(_seq) != msg_seq) {
+		if (node)
+			json_node_unref(node);
+		g_clear_error(&error);
+		return;
+	}
+	if (!node) {
+		fprintf(stderr, "Failed to send message: %s\n", error->message);
+		g_clear_error(&error);
+		return;
+	}
+
+	const gchar *id;
+	if (parse_string(node, "MessageId", &id))
+		msg_id = g_strdup(id);
+	json_node_unref(node);
+
+	g_array_append_val(send_ms, (gdouble){ elapsed_ms(msg_start) });
+	msg_sent = TRUE;
+
+	/* The last delivery was the response's; any before it was juggernaut's */
+	if (msg_deliveries >= 2)
+		message_echoed(msg_first_delivery);
+	message_done();
+}
+
+static gboolean message_timeout(gpointer ignored)
+{
+	msg_timer = 0;
+	msgs_lost++;
+	send_next_message();
+	return G_SOURCE_REMOVE;
+}
+
+static void send_next_message(void)
+{
+	g_clear_pointer(&msg_text, g_free);
+	g_clear_pointer(&msg_id, g_free);
+
+	if (msg_seq >= (guint)opt_messages) {
+		finish();
+		return;
+	}
+
+	struct bench_room *br = g_ptr_array_index(rooms, msg_seq % rooms->len);
+
+	msg_seq++;
+	msg_text = g_strdup_printf("chime-bench %d-%u %08x", getpid(), msg_seq, g_random_int());
+	msg_sent = msg_echoed = FALSE;
+	msg_deliveries = 0;
+	msg_start = g_get_monotonic_time();
+	msg_timer = g_timeout_add_seconds(MESSAGE_TIMEOUT, message_timeout, NULL);
+	chime_connection_send_message_async(cxn, CHIME_OBJECT(br->room), msg_text, NULL,
+					    message_sent, GUINT_TO_POINTER(msg_seq));
+}
+
+static void room_opened(struct bench_room *br)
+{
+	g_array_append_val(room_open_ms, (gdouble){ elapsed_ms(br->open_start) });
+	br->message_handler = g_signal_connect(br->room, "message",
+					       G_CALLBACK(on_room_message), NULL);
+
+	if (!--rooms_pending)
+		send_next_message();
+}
+
+static void on_members_done(ChimeRoom *room, struct bench_room *br)
+{
+	g_signal_handler_disconnect(room, br->members_handler);
+	br->members_handler = 0;
+	room_opened(br);
+}
+
+static void connected(ChimeConnection *conn, const gchar *display_name, gpointer ignored)
+{
+	guint i;
+
+	if (online_time >= 0)
+		return;
+	online_time = g_get_monotonic_time() - start_time;
+
+	chime_connection_foreach_room(cxn, collect_room, NULL);
+	if (!rooms->len) {
+		fprintf(stderr, "No rooms to use\n");
+		if (opt_messages) {
+			status = EXIT_FAILURE;
+			finish();
+			return;
+		}
+	}
+
+	rooms_pending = rooms->len;
+	for (i = 0; i < rooms->len; i++) {
+		struct bench_room *br = g_ptr_array_index(rooms, i);
+
+		br->open_start = g_get_monotonic_time();
+		br->members_handler = g_signal_connect(br->room, "members-done",
+						       G_CALLBACK(on_members_done), br);
+		if (chime_connection_open_room(cxn, br->room)) {
+			g_signal_handler_disconnect(br->room, br->members_handler);
+			br->members_handler = 0;
+			room_opened(br);
+		}
+	}
+	if (!rooms->len)
+		finish();
+}
+
+static void disconnected(ChimeConnection *conn, GError *error, gpointer ignored)
+{
+	if (error) {
+		fprintf(stderr, "Disconnected: %s\n", error->message);
+		status = EXIT_FAILURE;
+	}
+	if (g_main_loop_is_running(loop))
+		g_main_loop_quit(loop);
+}
+
+static gboolean overall_timeout(gpointer ignored)
+{
+	fprintf(stderr, "Timed out\n");
+	status = EXIT_FAILURE;
+	finish();
+	return G_SOURCE_REMOVE;
+}
+
+static int compare_double(gconstpointer a, gconstpointer b)
+{
+	gdouble x = *(const gdouble *)a, y = *(const gdouble *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void add_ms(JsonBuilder *jb, const gchar *name, gdouble ms)
+{
+	json_builder_set_member_name(jb, name);
+	if (ms < 0)
+		json_builder_add_null_value(jb);
+	else
+		json_builder_add_double_value(jb, ms);
+}
+
+static void add_stats(JsonBuilder *jb, const gchar *name, GArray *samples)
+{
+	gdouble *v = (gdouble *)samples->data, sum = 0;
+	guint i, n = samples->len;
+
+	g_array_sort(samples, compare_double);
+	for (i = 0; i < n; i++)
+		sum += v[i];
+
+	json_builder_set_member_name(jb, name);
+	json_builder_begin_object(jb);
+	json_builder_set_member_name(jb, "count");
+	json_builder_add_int_value(jb, n);
+	add_ms(jb, "min_ms", n ? v[0] : -1);
+	add_ms(jb, "mean_ms", n ? sum / n : -1);
+	add_ms(jb, "median_ms", n ? v[n / 2] : -1);
+	add_ms(jb, "p95_ms", n ? v[MIN(n - 1, n * 95 / 100)] : -1);
+	add_ms(jb, "max_ms", n ? v[n - 1] : -1);
+	json_builder_end_object(jb);
+}
+
+static void print_results(void)
+{
+	static const gchar *components[CHIME_ONLINE_LAST] = {
+		[CHIME_ONLINE_JUGG] = "jugg_online_ms",
+		[CHIME_ONLINE_CONTACTS] = "contacts_online_ms",
+		[CHIME_ONLINE_ROOMS] = "rooms_online_ms",
+		[CHIME_ONLINE_CONVERSATIONS] = "convs_online_ms",
+		[CHIME_ONLINE_MEETINGS] = "meetings_online_ms",
+	};
+	JsonBuilder *jb = json_builder_new();
+	JsonGenerator *jg = json_generator_new();
+	int i;
+
+	json_builder_begin_object(jb);
+
+	json_builder_set_member_name(jb, "connect");
+	json_builder_begin_object(jb);
+	add_ms(jb, "online_ms", online_time < 0 ? -1 : (gdouble)online_time / 1000);
+	for (i = 0; i < CHIME_ONLINE_LAST; i++) {
+		gint64 t = chime_connection_get_online_time(cxn, i);
+
+		add_ms(jb, components[i], t < 0 ? -1 : (gdouble)t / 1000);
+	}
+	json_builder_end_object(jb);
+
+	json_builder_set_member_name(jb, "rooms");
+	json_builder_begin_object(jb);
+	json_builder_set_member_name(jb, "requested");
+	json_builder_add_int_value(jb, opt_rooms);
+	add_stats(jb, "open", room_open_ms);
+	json_builder_end_object(jb);
+
+	json_builder_set_member_name(jb, "messages");
+	json_builder_begin_object(jb);
+	json_builder_set_member_name(jb, "requested");
+	json_builder_add_int_value(jb, opt_messages);
+	json_builder_set_member_name(jb, "lost");
+	json_builder_add_int_value(jb, msgs_lost);
+	add_stats(jb, "send", send_ms);
+	add_stats(jb, "echo", echo_ms);
+	json_builder_end_object(jb);
+
+	json_builder_end_object(jb);
+
+	JsonNode *root = json_builder_get_root(jb);
+	json_generator_set_root(jg, root);
+	json_generator_set_pretty(jg, TRUE);
+	gchar *out = json_generator_to_data(jg, NULL);
+	puts(out);
+
+	g_free(out);
+	json_node_unref(root);
+	g_object_unref(jg);
+	g_object_unref(jb);
+}
+
+static void finish(void)
+{
+	static gboolean finished;
+
+	if (finished)
+		return;
+	finished = TRUE;
+
+	if (msg_timer) {
+		g_source_remove(msg_timer);
+		msg_timer = 0;
+	}
+	g_clear_pointer(&msg_text, g_free);
+
+	print_results();
+
+	g_ptr_array_set_size(rooms, 0);
+	chime_connection_disconnect(cxn);
+	if (g_main_loop_is_running(loop))
+		g_main_loop_quit(loop);
+}
+
+int main(int argc, char *argv[])
+{
+	GOptionContext *ctx = g_option_context_new("EMAIL SESSION-TOKEN");
+	GError *error = NULL;
+
+	g_option_context_add_main_entries(ctx, entries, NULL);
+	if (!g_option_context_parse(ctx, &argc, &argv, &error) || argc != 3) {
+		fprintf(stderr, "%s\n", error ? error->message :
+			"Usage: chime-bench [OPTION...] EMAIL SESSION-TOKEN");
+		return EXIT_FAILURE;
+	}
+	g_option_context_free(ctx);
+
+	rooms = g_ptr_array_new_with_free_func(free_bench_room);
+	room_open_ms = g_array_new(FALSE, FALSE, sizeof(gdouble));
+	send_ms = g_array_new(FALSE, FALSE, sizeof(gdouble));
+	echo_ms = g_array_new(FALSE, FALSE, sizeof(gdouble));
+
+	loop = g_main_loop_new(NULL, FALSE);
+	cxn = chime_connection_new(argv[1], opt_server, "bench", argv[2]);
+
+	g_signal_connect(cxn, "connected", G_CALLBACK(connected), NULL);
+	g_signal_connect(cxn, "disconnected", G_CALLBACK(disconnected), NULL);
+	g_timeout_add_seconds(opt_timeout, overall_timeout, NULL);
+
+	start_time = g_get_monotonic_time();
+	chime_connection_connect(cxn);
+	g_main_loop_run(loop);
+
+	/* A failure before we got online still gets a (mostly empty) report */
+	finish();
+
+	g_ptr_array_free(rooms, TRUE);
+	g_array_free(room_open_ms, TRUE);
+	g_array_free(send_ms, TRUE);
+	g_array_free(echo_ms, TRUE);
+	g_object_unref(cxn);
+	g_main_loop_unref(loop);
+	return status;
+}
@@ -0,0 +1,502 @@
+/*
+ * Keep a connection busy for hours and check that resource usage stays
+ * bounded.
+ *
+ * Run it against a test account, or a local stand-in for the service
+ * with --server, using a session token from chime-get-token:
+ *
+ *	chime-soak --duration=14400 user@example.com <token>
+ *
+ * Every --cycle seconds it disconnects and reconnects with a fresh
+ * ChimeConnection. While online it opens and closes rooms, changes
+ * presence and (with --meetings) joins and leaves meetings. Once a
+ * second it checks RSS, open file descriptors, juggernaut subscriptions
+ * and collection sizes against the limits, and fails as soon as one of
+ * them is exceeded.
+ *
+ * The limits only catch gross leaks. To catch a few KiB per cycle, RSS,
+ * the fd count and (with CHIME_DEBUG=memory) the live object counts of
+ * each subsystem are also sampled after each teardown. The sample after
+ * --warmup-cycles is the baseline, and it fails if any of them has grown
+ * --growth-cycles times since then without ever shrinking in between.
+ */
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "chime/chime-connection.h"
+#include "chime/chime-room.h"
+#include "chime/chime-meeting.h"
+
+#define MAX_OPEN_ROOMS 5
+#define MEETING_TICKS 30
+
+static GMainLoop *loop;
+static int status = EXIT_SUCCESS;
+
+static gchar *opt_server;
+static gint opt_duration = 4 * 3600;
+static gint opt_cycle = 600;
+static gint opt_presence_burst = 10;
+static gint opt_max_rss = 512;
+static gint opt_max_fds = 256;
+static gint opt_max_subscriptions = 2000;
+static gint opt_max_objects = 100000;
+static gint opt_warmup_cycles = 2;
+static gint opt_growth_cycles = 8;
+static gboolean opt_meetings;
+
+static GOptionEntry entries[] = {
+	{ "server", 's', 0, G_OPTION_ARG_STRING, &opt_server, "Server URL", "URL" },
+	{ "duration", 'd', 0, G_OPTION_ARG_INT, &opt_duration, "Total run time", "SECS" },
+	{ "cycle", 'c', 0, G_OPTION_ARG_INT, &opt_cycle, "Reconnect interval", "SECS" },
+	{ "presence-burst", 'p', 0, G_OPTION_ARG_INT, &opt_presence_burst,
+	  "Presence changes sent each second", "N" },
+	{ "meetings", 'm', 0, G_OPTION_ARG_NONE, &opt_meetings, "Also join and leave meetings", NULL },
+	{ "max-rss", 0, 0, G_OPTION_ARG_INT, &opt_max_rss, "Resident set size limit", "MiB" },
+	{ "max-fds", 0, 0, G_OPTION_ARG_INT, &opt_max_fds, "Open file descriptor limit", "N" },
+	{ "max-subscriptions", 0, 0, G_OPTION_ARG_INT, &opt_max_subscriptions,
+	  "Juggernaut subscription limit", "N" },
+	{ "max-objects", 0, 0, G_OPTION_ARG_INT, &opt_max_objects,
+	  "Limit on the size of each object collection", "N" },
+	{ "warmup-cycles", 0, 0, G_OPTION_ARG_INT, &opt_warmup_cycles,
+	  "Cycles before the growth baseline is taken", "N" },
+	{ "growth-cycles", 0, 0, G_OPTION_ARG_INT, &opt_growth_cycles,
+	  "Fail after growing this many times without shrinking", "N" },
+	{ NULL }
+};
+
+static const gchar *email, *token;
+static ChimeConnection *cxn;
+static gint64 start_time;
+static guint tick_source, cycle_source;
+static guint cycles, ticks;
+static GQueue open_rooms = G_QUEUE_INIT;
+static ChimeMeeting *meeting;
+static guint meeting_ticks;
+
+static struct {
+	gint64 rss_kib;
+	gint64 fds;
+	gint64 subscriptions;
+	gint64 objects;
+} peak;
+
+/* What's left after each teardown, which shouldn't keep growing */
+struct trend {
+	const gchar *name;
+	gint64 baseline;
+	gint64 last;
+	guint rising;	/* Samples which grew since it last shrank */
+};
+
+enum {
+	TREND_RSS,
+	TREND_FDS,
+	TREND_MEM,	/* One per ChimeMemTag */
+	TREND_LAST = TREND_MEM + CHIME_MEM_LAST
+};
+
+static struct trend trends[TREND_LAST];
+
+static void start_cycle(void);
+
+static void fail(const gchar *format, ...) G_GNUC_PRINTF(1, 2);
+static void fail(const gchar *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	fputs("FAIL: ", stderr);
+	vfprintf(stderr, format, args);
+	fputs("\n", stderr);
+	va_end(args);
+
+	status = EXIT_FAILURE;
+	g_main_loop_quit(loop);
+}
+
+static gint64 rss_kib(void)
+{
+	gchar *statm;
+	gint64 pages = -1;
+
+	if (g_file_get_contents("/proc/self/statm", &statm, NULL, NULL)) {
+		sscanf(statm, "%*d %" G_GINT64_MODIFIER "d", &pages);
+		g_free(statm);
+	}
+	return pages < 0 ? -1 : pages * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+static gint64 open_fds(void)
+{
+	GDir *dir = g_dir_open("/proc/self/fd", 0, NULL);
+	gint64 n = 0;
+
+	if (!dir)
+		return -1;
+	while (g_dir_read_name(dir))
+		n++;
+	g_dir_close(dir);
+
+	/* Don't count the one used to read the directory */
+	return n - 1;
+}
+
+/* Pick a single sample out of the Prometheus text */
+static gint64 metric_value(const gchar *metrics, const gchar *name)
+{
+	gsize len = strlen(name);
+	const gchar *p = metrics;
+
+	while (p && *p) {
+		if (!strncmp(p, name, len) && p[len] == ' ')
+			return g_ascii_strtoll(p + len + 1, NULL, 10);
+		p = strchr(p, '\n');
+		if (p)
+			p++;
+	}
+	return 0;
+}
+
+#define UPDATE_PEAK(field, val) do { if ((val) > peak.field) peak.field = (val); } while (0)
+
+static gboolean check_limits(void)
+{
+	gint64 rss = rss_kib(), fds = open_fds();
+
+	UPDATE_PEAK(rss_kib, rss);
+	UPDATE_PEAK(fds, fds);
+
+	if (rss > (gint64)opt_max_rss * 1024) {
+		fail("RSS %" G_GINT64_FORMAT " KiB exceeds %d MiB", rss, opt_max_rss);
+		return FALSE;
+	}
+	if (fds > opt_max_fds) {
+		fail("%" G_GINT64_FORMAT " file descriptors open, limit %d", fds, opt_max_fds);
+		return FALSE;
+	}
+	if (!cxn)
+		return TRUE;
+
+	static const gchar * const collections[] = {
+		"contacts", "rooms", "conversations", "meetings", "calls"
+	};
+	gchar *metrics = chime_connection_get_metrics(cxn);
+	gint64 subs = metric_value(metrics, "chime_jugg_subscriptions");
+	guint i;
+
+	UPDATE_PEAK(subscriptions, subs);
+	if (subs > opt_max_subscriptions) {
+		fail("%" G_GINT64_FORMAT " juggernaut subscriptions, limit %d",
+		     subs, opt_max_subscriptions);
+		g_free(metrics);
+		return FALSE;
+	}
+	for (i = 0; i < G_N_ELEMENTS(collections); i++) {
+		gchar *name = g_strdup_printf("chime_objects{collection=\"%s\"}", collections[i]);
+		gint64 n = metric_value(metrics, name);
+
+		g_free(name);
+		UPDATE_PEAK(objects, n);
+		if (n > opt_max_objects) {
+			fail("%" G_GINT64_FORMAT " %s, limit %d", n, collections[i], opt_max_objects);
+			g_free(metrics);
+			return FALSE;
+		}
+	}
+	g_free(metrics);
+	return TRUE;
+}
+
+static gboolean sample_trend(struct trend *t, const gchar *name, gint64 val)
+{
+	if (cycles < (guint)opt_warmup_cycles)
+		return TRUE;
+
+	t->name = name;
+	if (cycles == (guint)opt_warmup_cycles) {
+		t->baseline = t->last = val;
+		t->rising = 0;
+		return TRUE;
+	}
+
+	if (val > t->last)
+		t->rising++;
+	else if (val < t->last)
+		t->rising = 0;
+	t->last = val;
+
+	if (t->rising >= (guint)opt_growth_cycles && val > t->baseline) {
+		fail("%s grew in %u cycles without shrinking, from %" G_GINT64_FORMAT
+		     " after cycle %d to %" G_GINT64_FORMAT " after cycle %u",
+		     name, t->rising, t->baseline, opt_warmup_cycles, val, cycles);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean check_growth(void)
+{
+	gint64 rss = rss_kib(), fds = open_fds();
+	guint i;
+
+	printf("Cycle %u: after teardown, RSS %" G_GINT64_FORMAT " KiB, %"
+	       G_GINT64_FORMAT " fds\n", cycles, rss, fds);
+
+	if (!sample_trend(&trends[TREND_RSS], "RSS (KiB)", rss) ||
+	    !sample_trend(&trends[TREND_FDS], "Open file descriptors", fds))
+		return FALSE;
+
+	for (i = 0; i < CHIME_MEM_LAST; i++) {
+		const gchar *name;
+		gssize objects;
+
+		if (!chime_mem_get_live(i, &name, &objects, NULL))
+			break;
+		if (!sample_trend(&trends[TREND_MEM + i], name, objects))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void collect_room(ChimeConnection *conn, ChimeRoom *room, gpointer _rooms)
+{
+	g_ptr_array_add(_rooms, room);
+}
+
+static void churn_rooms(void)
+{
+	GPtrArray *rooms = g_ptr_array_new();
+
+	chime_connection_foreach_room(cxn, collect_room, rooms);
+	if (rooms->len) {
+		ChimeRoom *room = g_ptr_array_index(rooms, g_random_int_range(0, rooms->len));
+
+		/* The result only says whether the members are known yet;
+		 * the room is open either way. */
+		if (!g_queue_find(&open_rooms, room)) {
+			chime_connection_open_room(cxn, room);
+			g_queue_push_tail(&open_rooms, g_object_ref(room));
+		}
+	}
+	g_ptr_array_free(rooms, TRUE);
+
+	while (g_queue_get_length(&open_rooms) > MAX_OPEN_ROOMS) {
+		ChimeRoom *room = g_queue_pop_head(&open_rooms);
+
+		chime_connection_close_room(cxn, room);
+		g_object_unref(room);
+	}
+}
+
+static void close_rooms(void)
+{
+	ChimeRoom *room;
+
+	while ((room = g_queue_pop_head(&open_rooms))) {
+		chime_connection_close_room(cxn, room);
+		g_object_unref(room);
+	}
+}
+
+static void presence_done(GObject *source, GAsyncResult *result, gpointer ignored)
+{
+	GError *error = NULL;
+
+	if (!chime_connection_set_presence_finish(CHIME_CONNECTION(source), result, &error)) {
+		fprintf(stderr, "Presence update failed: %s\n", error->message);
+		g_clear_error(&error);
+	}
+}
+
+static void presence_storm(void)
+{
+	int i;
+
+	for (i = 0; i < opt_presence_burst; i++)
+		chime_connection_set_presence_async(cxn, (ticks + i) & 1 ? "Busy" : "Automatic",
+						    NULL, NULL, presence_done, NULL);
+}
+
+static void meeting_joined(GObject *source, GAsyncResult *result, gpointer ignored)
+{
+	GError *error = NULL;
+	ChimeMeeting *mtg = chime_connection_join_meeting_finish(CHIME_CONNECTION(source),
+								 result, &error);
+
+	if (!mtg) {
+		fprintf(stderr, "Meeting join failed: %s\n", error->message);
+		g_clear_error(&error);
+		return;
+	}
+	/* The connection may have been cycled in the meantime */
+	if (CHIME_CONNECTION(source) != cxn || meeting) {
+		chime_connection_close_meeting(CHIME_CONNECTION(source), mtg);
+		g_object_unref(mtg);
+		return;
+	}
+	meeting = mtg;
+	meeting_ticks = 0;
+}
+
+static void pick_meeting(ChimeConnection *conn, ChimeMeeting *mtg, gpointer _pick)
+{
+	ChimeMeeting **pick = _pick;
+
+	if (!*pick)
+		*pick = mtg;
+}
+
+static void leave_meeting(void)
+{
+	if (meeting) {
+		chime_connection_close_meeting(cxn, meeting);
+		g_clear_object(&meeting);
+	}
+}
+
+static void churn_meetings(void)
+{
+	ChimeMeeting *mtg = NULL;
+
+	if (meeting) {
+		if (++meeting_ticks >= MEETING_TICKS)
+			leave_meeting();
+		return;
+	}
+
+	chime_connection_foreach_meeting(cxn, pick_meeting, &mtg);
+	if (mtg && !(ticks % MEETING_TICKS))
+		chime_connection_join_meeting_async(cxn, mtg, TRUE, NULL, meeting_joined, NULL);
+}
+
+static gboolean tick(gpointer ignored)
+{
+	ticks++;
+
+	if (!check_limits()) {
+		tick_source = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	churn_rooms();
+	presence_storm();
+	if (opt_meetings)
+		churn_meetings();
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean end_cycle(gpointer ignored)
+{
+	cycle_source = 0;
+	if (tick_source) {
+		g_source_remove(tick_source);
+		tick_source = 0;
+	}
+
+	leave_meeting();
+	close_rooms();
+
+	printf("Cycle %u: disconnecting\n", cycles);
+	chime_connection_disconnect(cxn);
+	return G_SOURCE_REMOVE;
+}
+
+static void connected(ChimeConnection *conn, const gchar *display_name, gpointer ignored)
+{
+	printf("Cycle %u: connected as %s\n", cycles, display_name);
+
+	if (tick_source)
+		return;
+	tick_source = g_timeout_add_seconds(1, tick, NULL);
+	cycle_source = g_timeout_add_seconds(opt_cycle, end_cycle, NULL);
+}
+
+static gboolean next_cycle(gpointer ignored)
+{
+	g_clear_object(&cxn);
+
+	/* Whatever the last connection left behind is still counted */
+	if (!check_limits() || !check_growth())
+		return G_SOURCE_REMOVE;
+
+	if (g_get_monotonic_time() - start_time >= (gint64)opt_duration * G_USEC_PER_SEC)
+		g_main_loop_quit(loop);
+	else
+		start_cycle();
+
+	return G_SOURCE_REMOVE;
+}
+
+static void disconnected(ChimeConnection *conn, GError *error, gpointer ignored)
+{
+	if (error) {
+		fail("Cycle %u: disconnected: %s", cycles, error->message);
+		return;
+	}
+	/* Not from within the connection's own signal emission */
+	g_idle_add(next_cycle, NULL);
+}
+
+static void start_cycle(void)
+{
+	cycles++;
+	cxn = chime_connection_new(email, opt_server, "soak", token);
+
+	g_signal_connect(cxn, "connected", G_CALLBACK(connected), NULL);
+	g_signal_connect(cxn, "disconnected", G_CALLBACK(disconnected), NULL);
+
+	chime_connection_connect(cxn);
+}
+
+int main(int argc, char *argv[])
+{
+	GOptionContext *ctx = g_option_context_new("EMAIL SESSION-TOKEN");
+	GError *error = NULL;
+
+	g_option_context_add_main_entries(ctx, entries, NULL);
+	if (!g_option_context_parse(ctx, &argc, &argv, &error) || argc != 3) {
+		fprintf(stderr, "%s\n", error ? error->message :
+			"Usage: chime-soak [OPTION...] EMAIL SESSION-TOKEN");
+		return EXIT_FAILURE;
+	}
+	g_option_context_free(ctx);
+
+	if (opt_warmup_cycles < 1 || opt_growth_cycles < 1) {
+		fprintf(stderr, "--warmup-cycles and --growth-cycles must be at least 1\n");
+		return EXIT_FAILURE;
+	}
+
+	email = argv[1];
+	token = argv[2];
+
+	loop = g_main_loop_new(NULL, FALSE);
+	start_time = g_get_monotonic_time();
+	start_cycle();
+	g_main_loop_run(loop);
+
+	if (tick_source)
+		g_source_remove(tick_source);
+	if (cycle_source)
+		g_source_remove(cycle_source);
+	if (cxn) {
+		leave_meeting();
+		close_rooms();
+		chime_connection_disconnect(cxn);
+		g_object_unref(cxn);
+	}
+	g_main_loop_unref(loop);
+
+	printf("%s after %u cycles, %" G_GINT64_FORMAT "s\n",
+	       status == EXIT_SUCCESS ? "PASS" : "FAIL", cycles,
+	       (g_get_monotonic_time() - start_time) / G_USEC_PER_SEC);
+	printf("Peak RSS %" G_GINT64_FORMAT " KiB, fds %" G_GINT64_FORMAT
+	       ", subscriptions %" G_GINT64_FORMAT ", largest collection %" G_GINT64_FORMAT "\n",
+	       peak.rss_kib, peak.fds, peak.subscriptions, peak.objects);
+
+	return status;
+}
@@ -0,0 +1,392 @@
+/*
+ * Pidgin/libpurple Chime client plugin
+ *
+ * Copyright © 2017 Amazon.com, Inc. or its affiliates.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "chime-connection-private.h"
+
+#include <string.h>
+
+/*
+ * Unread state for rooms and conversations, kept up to date from the
+ * LastSent / LastRead / LastMentioned fields of their records and from
+ * the messages which arrive over Juggernaut, so that clients can show
+ * what needs attention without fetching messages for everything.
+ *
+ * The server doesn't tell us how many messages are unread, only when the
+ * last one was sent and read. So the counts are of the messages we have
+ * seen arrive since the last read marker; an object whose LastSent is
+ * after its LastRead is unread even if we haven't seen any of them.
+ *
+ * Objects with unread activity are also kept in activity_index, newest
+ * first, so that chime_connection_foreach_unread() only visits as many
+ * as it returns. Like the room directory, nothing here holds references;
+ * entries are dropped as soon as their object dies.
+ *
+ * The timestamps are all ISO 8601 in UTC in the same format, so they are
+ * simply compared as strings.
+ *
+ * Our own read marker names a message rather than a time, so the last few
+ * messages seen for each object are remembered in order to find out how
+ * far it reaches once the server has accepted it.
+ */
+#define ACTIVITY_RECENT_MSGS 10
+
+struct activity_msg {
+	gchar *id;
+	gchar *created;
+};
+
+struct chime_activity {
+	ChimeObject *obj;
+	gchar *last_activity;
+	gchar *last_read;
+	gchar *last_mentioned;
+	guint unread;
+	guint mentions;
+	GQueue *recent;		/* struct activity_msg, newest first */
+	GSequenceIter *iter;	/* In activity_index while there's unread activity */
+};
+
+static gint time_cmp(const gchar *a, const gchar *b)
+{
+	if (!a || !b)
+		return !!a - !!b;
+	return strcmp(a, b);
+}
+
+/* Advance a timestamp, returning TRUE if it moved */
+static gboolean advance_time(gchar **field, const gchar *t)
+{
+	if (!t || time_cmp(t, *field) <= 0)
+		return FALSE;
+
+	g_free(*field);
+	*field = g_strdup(t);
+	return TRUE;
+}
+
+static gboolean activity_has_unread(struct chime_activity *a)
+{
+	/* Without a read marker, only count what we've seen arrive */
+	return a->unread || (a->last_read && time_cmp(a->last_activity, a->last_read) > 0);
+}
+
+static gboolean activity_has_mention(struct chime_activity *a)
+{
+	return a->mentions || (a->last_read && time_cmp(a->last_mentioned, a->last_read) > 0);
+}
+
+/* Newest first */
+static gint activity_cmp(gconstpointer _a, gconstpointer _b, gpointer unused)
+{
+	const struct chime_activity *a = _a, *b = _b;
+
+	return time_cmp(b->last_activity, a->last_activity);
+}
+
+static void activity_reindex(ChimeConnectionPrivate *priv, struct chime_activity *a,
+			     gboolean moved)
+{
+	if (!activity_has_unread(a)) {
+		if (a->iter) {
+			g_sequence_remove(a->iter);
+			a->iter = NULL;
+		}
+	} else if (!a->iter)
+		a->iter = g_sequence_insert_sorted(priv->activity_index, a, activity_cmp, NULL);
+	else if (moved)
+		g_sequence_sort_changed(a->iter, activity_cmp, NULL);
+}
+
+/* Everything up to the last activity has been read */
+static void activity_read(struct chime_activity *a)
+{
+	advance_time(&a->last_read, a->last_activity);
+	a->unread = a->mentions = 0;
+}
+
+/* We don't know the times of the messages we counted, so they all stay
+ * unread until everything is. */
+static void activity_read_until(struct chime_activity *a, const gchar *t)
+{
+	if (advance_time(&a->last_read, t) &&
+	    time_cmp(a->last_read, a->last_activity) >= 0)
+		a->unread = a->mentions = 0;
+}
+
+static void free_activity_msg(gpointer _m)
+{
+	struct activity_msg *m = _m;
+
+	g_free(m->id);
+	g_free(m->created);
+	g_free(m);
+}
+
+/* Newest first; fetched messages don't arrive in order */
+static gint activity_msg_cmp(gconstpointer _a, gconstpointer _b, gpointer unused)
+{
+	const struct activity_msg *a = _a, *b = _b;
+
+	return time_cmp(b->created, a->created);
+}
+
+static void remember_msg(struct chime_activity *a, JsonNode *record)
+{
+	const gchar *id, *created;
+	struct activity_msg *m;
+	GList *l;
+
+	if (!parse_string(record, "MessageId", &id) ||
+	    !parse_string(record, "CreatedOn", &created))
+		return;
+
+	for (l = a->recent->head; l; l = l->next) {
+		if (!strcmp(((struct activity_msg *)l->data)->id, id))
+			return;
+	}
+
+	m = g_new0(struct activity_msg, 1);
+	m->id = g_strdup(id);
+	m->created = g_strdup(created);
+	g_queue_insert_sorted(a->recent, m, activity_msg_cmp, NULL);
+	if (a->recent->length > ACTIVITY_RECENT_MSGS)
+		free_activity_msg(g_queue_pop_tail(a->recent));
+}
+
+static void on_activity_dead(ChimeObject *obj, GParamSpec *ignored, ChimeConnection *cxn);
+static void on_activity_msg(ChimeObject *obj, JsonNode *record, ChimeConnection *cxn);
+
+static void free_activity(gpointer _a)
+{
+	struct chime_activity *a = _a;
+
+	if (a->iter)
+		g_sequence_remove(a->iter);
+	g_free(a->last_activity);
+	g_free(a->last_read);
+	g_free(a->last_mentioned);
+	g_queue_free_full(a->recent, free_activity_msg);
+	g_free(a);
+}
+
+static struct chime_activity *find_activity(ChimeConnection *cxn, ChimeObject *obj,
+					    gboolean create)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE(cxn);
+	struct chime_activity *a = NULL;
+
+	if (priv->activity)
+		a = g_hash_table_lookup(priv->activity, obj);
+	if (a || !create || chime_object_is_dead(obj))
+		return a;
+
+	if (!priv->activity) {
+		priv->activity = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+						       NULL, free_activity);
+		priv->activity_index = g_sequence_new(NULL);
+	}
+
+	a = g_new0(struct chime_activity, 1);
+	a->obj = obj;
+	a->recent = g_queue_new();
+	g_hash_table_insert(priv->activity, obj, a);
+	g_signal_connect(obj, "notify::dead", G_CALLBACK(on_activity_dead), cxn);
+	/* Fetched and sent messages; they don't count as activity */
+	g_signal_connect(obj, "message", G_CALLBACK(on_activity_msg), cxn);
+	return a;
+}
+
+static void on_activity_msg(ChimeObject *obj, JsonNode *record, ChimeConnection *cxn)
+{
+	struct chime_activity *a = find_activity(cxn, obj, FALSE);
+
+	if (a)
+		remember_msg(a, record);
+}
+
+static void on_activity_dead(ChimeObject *obj, GParamSpec *ignored, ChimeConnection *cxn)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE(cxn);
+
+	if (!chime_object_is_dead(obj))
+		return;
+
+	/* It'll be back with fresh state from its record if it revives */
+	g_signal_handlers_disconnect_by_func(obj, on_activity_dead, cxn);
+	g_signal_handlers_disconnect_by_func(obj, on_activity_msg, cxn);
+	g_hash_table_remove(priv->activity, obj);
+}
+
+/* From the fields of a room or conversation record */
+void chime_activity_update(ChimeConnection *cxn, ChimeObject *obj, const gchar *last_sent,
+			   const gchar *last_read, const gchar *last_mentioned)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE(cxn);
+	struct chime_activity *a = find_activity(cxn, obj, TRUE);
+	gboolean moved;
+
+	if (!a)
+		return;
+
+	moved = advance_time(&a->last_activity, last_sent);
+	advance_time(&a->last_mentioned, last_mentioned);
+
+	/* Read elsewhere, perhaps */
+	activity_read_until(a, last_read);
+
+	activity_reindex(priv, a, moved);
+}
+
+/* For each message which arrives, with @mention if it's for us */
+void chime_activity_message(ChimeConnection *cxn, ChimeObject *obj, JsonNode *record,
+			    gboolean mention)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE(cxn);
+	struct chime_activity *a = find_activity(cxn, obj, TRUE);
+	const gchar *created = NULL, *sender;
+	gboolean moved;
+
+	if (!a)
+		return;
+
+	parse_string(record, "CreatedOn", &created);
+	remember_msg(a, record);
+
+	/* Edits of messages which were already read come through again */
+	if (created && a->last_read && time_cmp(created, a->last_read) <= 0)
+		return;
+
+	moved = advance_time(&a->last_activity, created);
+
+	if (parse_string(record, "Sender", &sender) &&
+	    !g_strcmp0(sender, chime_connection_get_profile_id(cxn))) {
+		/* We must have read everything before our own reply */
+		activity_read(a);
+	} else {
+		a->unread++;
+		if (mention) {
+			a->mentions++;
+			advance_time(&a->last_mentioned, created);
+		}
+	}
+
+	activity_reindex(priv, a, moved);
+}
+
+/* When the server has accepted our own read marker, up to @msg_id */
+void chime_activity_mark_read(ChimeConnection *cxn, ChimeObject *obj, const gchar *msg_id)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE(cxn);
+	struct chime_activity *a = find_activity(cxn, obj, FALSE);
+	GList *l;
+
+	if (!a)
+		return;
+
+	/* If it's not one we've seen, the object's record will catch up */
+	for (l = a->recent->head; l; l = l->next) {
+		struct activity_msg *m = l->data;
+
+		if (!strcmp(m->id, msg_id)) {
+			activity_read_until(a, m->created);
+			activity_reindex(priv, a, FALSE);
+			return;
+		}
+	}
+}
+
+static void disconnect_activity(gpointer obj, gpointer a, gpointer cxn)
+{
+	g_signal_handlers_disconnect_by_func(obj, on_activity_dead, cxn);
+	g_signal_handlers_disconnect_by_func(obj, on_activity_msg, cxn);
+}
+
+void chime_destroy_activity(ChimeConnection *cxn)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE(cxn);
+
+	if (!priv->activity)
+		return;
+
+	g_hash_table_foreach(priv->activity, disconnect_activity, cxn);
+	g_clear_pointer(&priv->activity, g_hash_table_destroy);
+	g_clear_pointer(&priv->activity_index, g_sequence_free);
+}
+
+/**
+ * chime_connection_get_unread:
+ * @cxn: the connection
+ * @obj: a room or conversation
+ * @unread: (out) (allow-none): the number of unread messages seen to arrive
+ * @mentions: (out) (allow-none): how many of those mentioned us
+ *
+ * The counts may be zero even when there is unread activity, if it
+ * happened while we weren't connected.
+ *
+ * Returns: %TRUE if @obj has unread activity
+ */
+gboolean chime_connection_get_unread(ChimeConnection *cxn, ChimeObject *obj,
+				     guint *unread, guint *mentions)
+{
+	g_return_val_if_fail(CHIME_IS_CONNECTION(cxn), FALSE);
+	g_return_val_if_fail(CHIME_IS_OBJECT(obj), FALSE);
+	struct chime_activity *a = find_activity(cxn, obj, FALSE);
+
+	if (unread)
+		*unread = a ? a->unread : 0;
+	if (mentions)
+		*mentions = a && activity_has_mention(a) ? MAX(a->mentions, 1) : 0;
+
+	return a && activity_has_unread(a);
+}
+
+/**
+ * chime_connection_foreach_unread:
+ * @cxn: the connection
+ * @limit: the maximum number to visit, or zero for all
+ * @cb: (allow-none): callback for each room or conversation
+ * @cbdata: data for @cb
+ *
+ * Invokes @cb for the rooms and conversations with unread activity, the
+ * most recently active first.
+ *
+ * Returns: the total number of rooms and conversations with unread activity
+ */
+guint chime_connection_foreach_unread(ChimeConnection *cxn, guint limit,
+				      ChimeObjectCB cb, gpointer cbdata)
+{
+	g_return_val_if_fail(CHIME_IS_CONNECTION(cxn), 0);
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE(cxn);
+	GSequenceIter *iter;
+	guint total, i;
+
+	if (!priv->activity_index)
+		return 0;
+
+	total = g_sequence_get_length(priv->activity_index);
+	if (!cb)
+		return total;
+
+	iter = g_sequence_get_begin_iter(priv->activity_index);
+	for (i = 0; !g_sequence_iter_is_end(iter) && (!limit || i < limit); i++) {
+		struct chime_activity *a = g_sequence_get(iter);
+
+		/* In case the callback marks it read */
+		iter = g_sequence_iter_next(iter);
+		cb(cxn, a->obj, cbdata);
+	}
+
+	return total;
+}
@@ -67,7 +67,7 @@ static gboolean audio_receive_rt_msg(ChimeCallAudio *audio, gconstpointer pkt, g
 			GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
 			if (gst_rtp_buffer_map(buffer, GST_MAP_WRITE, &rtp)) {
 
-				chime_debug("Audio RX seq %d ts %u\n", msg->audio->seq, msg->audio->sample_time);
+				chime_debug_cat(CHIME_LOG_AUDIO, "Audio RX seq %d ts %u\n", msg->audio->seq, msg->audio->sample_time);
 
 				gst_rtp_buffer_set_ssrc(&rtp, audio->recv_ssrc);
 				gst_rtp_buffer_set_payload_type(&rtp, 97);
@@ -81,9 +81,12 @@ static gboolean audio_receive_rt_msg(ChimeCallAudio *audio, gconstpointer pkt, g
 				gst_app_src_push_buffer(GST_APP_SRC(audio->audio_src), buffer);
 			}
 		} else if (msg->audio->has_audio && msg->audio->audio.len) {
-			chime_debug("Audio drop (%p %d) seq %d ts %u\n",
-				    audio->audio_src, audio->appsrc_need_data,
-				    msg->audio->seq, msg->audio->sample_time);
+			ChimeConnection *cxn = chime_call_get_connection(audio->call);
+			if (cxn)
+				chime_metric_inc(cxn, CHIME_METRIC_AUDIO_RX_DROPPED);
+			chime_debug_cat(CHIME_LOG_AUDIO, "Audio drop (%p %d) seq %d ts %u\n",
+					audio->audio_src, audio->appsrc_need_data,
+					msg->audio->seq, msg->audio->sample_time);
 		}
 
 	}
@@ -96,8 +99,8 @@ static gboolean audio_receive_rt_msg(ChimeCallAudio *audio, gconstpointer pkt, g
 		const gchar *profile_id = g_hash_table_lookup(audio->profiles,
 							      GUINT_TO_POINTER(msg->profiles[i]->stream_id));
 		if (!profile_id) {
-			chime_debug("no profile for stream id %d\n",
-			       msg->profiles[i]->stream_id);
+			chime_debug_cat(CHIME_LOG_AUDIO, "no profile for stream id %d\n",
+					msg->profiles[i]->stream_id);
 			continue;
 		}
 
@@ -112,7 +115,7 @@ static gboolean audio_receive_rt_msg(ChimeCallAudio *audio, gconstpointer pkt, g
 		int signal_strength = -1;
 		if (msg->profiles[i]->has_signal_strength)
 			signal_strength = msg->profiles[i]->signal_strength;
-		chime_debug("Participant %s vol %d\n", profile_id, vol);
+		chime_debug_cat(CHIME_LOG_AUDIO, "Participant %s vol %d\n", profile_id, vol);
 		if (chime_call_participant_audio_stats(audio->call, profile_id, vol, signal_strength))
 			send_sig = TRUE;
 	}
@@ -144,7 +147,7 @@ static void do_send_rt_packet(ChimeCallAudio *audio, GstBuffer *buffer)
 	g_mutex_lock(&audio->rt_lock);
 	gint64 now = g_get_monotonic_time();
 	if (!audio->timeout_source && audio->last_rx + 10000000 < now) {
-		chime_debug("RX timeout, reconnect audio\n");
+		chime_debug_cat(CHIME_LOG_AUDIO, "RX timeout, reconnect audio\n");
 		audio->timeout_source = g_timeout_add(0, audio_reconnect, audio);
 	}
 	audio->audio_msg.seq = (audio->audio_msg.seq + 1) & 0xffff;
@@ -178,7 +181,7 @@ static void do_send_rt_packet(ChimeCallAudio *audio, GstBuffer *buffer)
 		dur = GST_BUFFER_DURATION(buffer);
 
 		nr_samples = GST_BUFFER_DURATION(buffer) / NS_PER_SAMPLE;
-		chime_debug("buf dts %ld pts %ld dur %ld samples %d\n", dts, pts, dur, nr_samples);
+		chime_debug_cat(CHIME_LOG_AUDIO, "buf dts %ld pts %ld dur %ld samples %d\n", dts, pts, dur, nr_samples);
 
 		if (audio->next_dts && dts > audio->next_dts) {
 			/* We skipped some. */
@@ -203,6 +206,10 @@ static void do_send_rt_packet(ChimeCallAudio *audio, GstBuffer *buffer)
 	}
 	audio->last_send_local_time = now;
 	chime_call_transport_send_packet(audio, XRP_RT_MESSAGE, &audio->rt_msg.base);
+
+	ChimeConnection *cxn = chime_call_get_connection(audio->call);
+	if (cxn)
+		chime_metric_inc(cxn, CHIME_METRIC_AUDIO_TX_PACKETS);
 	if (audio->audio_msg.audio.data) {
 		audio->audio_msg.audio.data = NULL;
 		gst_rtp_buffer_unmap(&rtp);
@@ -224,7 +231,7 @@ static gboolean audio_receive_auth_msg(ChimeCallAudio *audio, gconstpointer pkt,
 	if (!msg)
 		return FALSE;
 
-	chime_debug("Got AuthMessage authorised %d %d\n", msg->has_authorized, msg->authorized);
+	chime_debug_cat(CHIME_LOG_AUDIO, "Got AuthMessage authorised %d %d\n", msg->has_authorized, msg->authorized);
 	if (msg->has_authorized && msg->authorized) {
 		do_send_rt_packet(audio, NULL);
 		chime_call_audio_set_state(audio, audio->silent ? CHIME_AUDIO_STATE_AUDIOLESS :
@@ -270,6 +277,7 @@ static struct message_buf *find_msgbuf(ChimeCallAudio *audio, gint32 msg_id, gin
 	m->msg_id = msg_id;
 	m->len = msg_len;
 	m->buf = g_malloc0(msg_len);
+	chime_mem_account(CHIME_MEM_AUDIO_REASSEMBLY, sizeof(*m) + msg_len, 1);
 	/* Insert into the correct place in the sorted list */
 	*l = g_slist_prepend(*l, m);
 	return m;
@@ -281,7 +289,9 @@ static void free_msgbuf(struct message_buf *m)
 		struct message_frag *f = m->frags;
 		m->frags = f->next;
 		g_free(f);
+		chime_mem_account(CHIME_MEM_AUDIO_REASSEMBLY, -(gssize)sizeof(*f), 0);
 	}
+	chime_mem_account(CHIME_MEM_AUDIO_REASSEMBLY, -(gssize)(sizeof(*m) + m->len), -1);
 	g_free(m->buf);
 	g_free(m);
 }
@@ -344,6 +354,8 @@ static gboolean insert_frag(struct message_buf *m, gint32 start, gint32 end)
 					(*f)->end = nf->end;
 					(*f)->next = nf->next;
 					g_free(nf);
+					chime_mem_account(CHIME_MEM_AUDIO_REASSEMBLY,
+							  -(gssize)sizeof(*nf), 0);
 				}
 			}
 			goto done;
@@ -353,6 +365,7 @@ static gboolean insert_frag(struct message_buf *m, gint32 start, gint32 end)
 		}
 	}
 	nf = g_new0(struct message_frag, 1);
+	chime_mem_account(CHIME_MEM_AUDIO_REASSEMBLY, sizeof(*nf), 0);
 	nf->start = start;
 	nf->end = end;
 	nf->next = *f;
@@ -378,7 +391,7 @@ static gboolean audio_receive_stream_msg(ChimeCallAudio *audio, gconstpointer pk
 		if (!msg->streams[i]->profile_id || !msg->streams[i]->has_stream_id)
 			continue;
 
-		chime_debug("Stream %d: id %x uuid %s\n", i, msg->streams[i]->stream_id, msg->streams[i]->profile_id);
+		chime_debug_cat(CHIME_LOG_AUDIO, "Stream %d: id %x uuid %s\n", i, msg->streams[i]->stream_id, msg->streams[i]->profile_id);
 		g_hash_table_insert(audio->profiles, GUINT_TO_POINTER(msg->streams[i]->stream_id),
 				    g_strdup(msg->streams[i]->profile_id));
 	}
@@ -395,7 +408,7 @@ static gboolean audio_receive_data_msg(ChimeCallAudio *audio, gconstpointer pkt,
 	if (!msg)
 		return FALSE;
 
-	chime_debug("Got DataMessage seq %d msg_id %d offset %d\n", msg->seq, msg->msg_id, msg->offset);
+	chime_debug_cat(CHIME_LOG_AUDIO, "Got DataMessage seq %d msg_id %d offset %d\n", msg->seq, msg->msg_id, msg->offset);
 	if (!msg->has_seq || !msg->has_msg_id || !msg->has_msg_len)
 		goto fail;
 
@@ -464,7 +477,21 @@ static gboolean audio_receive_data_msg(ChimeCallAudio *audio, gconstpointer pkt,
 	return ret;
 }
 
+static gboolean do_audio_receive_packet(ChimeCallAudio *audio, gconstpointer pkt, gsize len);
+
 gboolean audio_receive_packet(ChimeCallAudio *audio, gconstpointer pkt, gsize len)
+{
+	struct chime_scope scope;
+	gboolean ret;
+
+	chime_scope_enter(&scope, "audio", NULL);
+	ret = do_audio_receive_packet(audio, pkt, len);
+	chime_scope_exit(&scope);
+
+	return ret;
+}
+
+static gboolean do_audio_receive_packet(ChimeCallAudio *audio, gconstpointer pkt, gsize len)
 {
 	if (len < sizeof(struct xrp_header))
 		return FALSE;
@@ -475,6 +502,10 @@ gboolean audio_receive_packet(ChimeCallAudio *audio, gconstpointer pkt, gsize le
 
 	audio->last_rx = g_get_monotonic_time();
 
+	ChimeConnection *cxn = chime_call_get_connection(audio->call);
+	if (cxn)
+		chime_metric_inc(cxn, CHIME_METRIC_AUDIO_RX_PACKETS);
+
 	/* Point to the payload, without (void *) arithmetic */
 	pkt = hdr + 1;
 	len -= 4;
@@ -497,7 +528,7 @@ void chime_call_audio_close(ChimeCallAudio *audio, gboolean hangup)
 {
 	g_signal_handlers_disconnect_matched(G_OBJECT(audio->call), G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, audio);
 
-	chime_debug("close audio\n");
+	chime_debug_cat(CHIME_LOG_AUDIO, "close audio\n");
 
 	if (audio->audio_src)
 		gst_app_src_set_callbacks(audio->audio_src, &no_appsrc_callbacks, NULL, NULL);
@@ -130,7 +130,7 @@ static void on_screenws_message(SoupWebsocketConnection *ws, gint type,
 	gsize s;
 	gconstpointer d = g_bytes_get_data(message, &s);
 
-	if (getenv("CHIME_SCREEN_DEBUG")) {
+	if (chime_log_enabled(CHIME_LOG_SCREEN_PACKETS)) {
 		printf("incoming:\n");
 		hexdump(d, s);
 	}
@@ -138,6 +138,9 @@ static void on_screenws_message(SoupWebsocketConnection *ws, gint type,
 	if (s < 4)
 		return;
 
+	struct chime_scope scope;
+	chime_scope_enter(&scope, "screen", NULL);
+
 	const struct screen_pkt *pkt = d;
 	switch(pkt->type) {
 	case SCREEN_PKT_TYPE_HEARTBEAT_REQUEST:
@@ -171,6 +174,8 @@ static void on_screenws_message(SoupWebsocketConnection *ws, gint type,
 		}
 		break;
 	}
+
+	chime_scope_exit(&scope);
 }
 
 
@@ -183,14 +188,14 @@ static void screen_ws_connect_cb(GObject *obj, GAsyncResult *res, gpointer _scre
 	if (!ws) {
 		/* If it was cancelled, 'screen' may have been freed. */
 		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
-			chime_debug("screen ws error %s\n", error->message);
+			chime_debug_cat(CHIME_LOG_SCREEN, "screen ws error %s\n", error->message);
 			chime_call_screen_set_state(screen, CHIME_SCREEN_STATE_FAILED, error->message);
 		}
 		g_clear_error(&error);
 		g_object_unref(cxn);
 		return;
 	}
-	chime_debug("screen ws connected!\n");
+	chime_debug_cat(CHIME_LOG_SCREEN, "screen ws connected!\n");
 	g_signal_connect(G_OBJECT(ws), "closed", G_CALLBACK(on_screenws_closed), screen);
 	g_signal_connect(G_OBJECT(ws), "message", G_CALLBACK(on_screenws_message), screen);
 
@@ -244,7 +249,7 @@ ChimeCallScreen *chime_call_screen_open(ChimeConnection *cxn, ChimeCall *call)
 
 static void on_final_screenws_close(SoupWebsocketConnection *ws, gpointer _unused)
 {
-	chime_debug("screen ws close\n");
+	chime_debug_cat(CHIME_LOG_SCREEN, "screen ws close\n");
 	g_object_unref(ws);
 }
 
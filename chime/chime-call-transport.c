@@ -64,7 +64,7 @@ static void on_audiows_message(SoupWebsocketConnection *ws, gint type,
 	gsize s;
 	gconstpointer d = g_bytes_get_data(message, &s);
 
-	if (getenv("CHIME_AUDIO_DEBUG")) {
+	if (chime_log_enabled(CHIME_LOG_AUDIO_PACKETS)) {
 		printf("incoming:\n");
 		hexdump(d, s);
 	}
@@ -160,14 +160,14 @@ static void audio_ws_connect_cb(GObject *obj, GAsyncResult *res, gpointer _audio
 	if (!ws) {
 		/* If it was cancelled, 'audio' may have been freed. */
 		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
-			chime_debug("audio ws error %s\n", error->message);
+			chime_debug_cat(CHIME_LOG_AUDIO, "audio ws error %s\n", error->message);
 			audio->state = CHIME_AUDIO_STATE_FAILED;
 		}
 		g_clear_error(&error);
 		g_object_unref(cxn);
 		return;
 	}
-	chime_debug("audio ws connected!\n");
+	chime_debug_cat(CHIME_LOG_AUDIO, "audio ws connected!\n");
 	g_signal_connect(G_OBJECT(ws), "closed", G_CALLBACK(on_audiows_closed), audio);
 	g_signal_connect(G_OBJECT(ws), "message", G_CALLBACK(on_audiows_message), audio);
 	audio->ws = ws;
@@ -394,7 +394,7 @@ static gboolean dtls_src_cb(GDatagramBased *dgram, GIOCondition condition, Chime
 		}
 
 		if (ret) {
-			chime_debug("DTLS failed: %s\n", gnutls_strerror(ret));
+			chime_debug_cat(CHIME_LOG_AUDIO, "DTLS failed: %s\n", gnutls_strerror(ret));
 			gnutls_deinit(audio->dtls_sess);
 			audio->dtls_sess = NULL;
 			g_source_destroy(audio->dtls_source);
@@ -409,7 +409,7 @@ static gboolean dtls_src_cb(GDatagramBased *dgram, GIOCondition condition, Chime
 			return G_SOURCE_REMOVE;
 		}
 
-		chime_debug("DTLS established\n");
+		chime_debug_cat(CHIME_LOG_AUDIO, "DTLS established\n");
 		g_source_remove(audio->timeout_source);
 		audio->timeout_source = 0;
 		audio->dtls_handshaked = TRUE;
@@ -420,7 +420,7 @@ static gboolean dtls_src_cb(GDatagramBased *dgram, GIOCondition condition, Chime
 	unsigned char pkt[CHIME_DTLS_MTU];
 	ssize_t len = gnutls_record_recv(audio->dtls_sess, pkt, sizeof(pkt));
 	if (len > 0) {
-		if (getenv("CHIME_AUDIO_DEBUG")) {
+		if (chime_log_enabled(CHIME_LOG_AUDIO_PACKETS)) {
 			printf("incoming:\n");
 			hexdump(pkt, len);
 		}
@@ -453,7 +453,7 @@ static int dtls_verify_cb(gnutls_session_t sess)
 		gnutls_datum_t reasons;
 		if (gnutls_certificate_verification_status_print(status, GNUTLS_CRT_X509, &reasons, 0) != GNUTLS_E_SUCCESS)
 			reasons.data = NULL;
-		chime_debug("DTLS certificate verification failed (%u): %s\n", status, reasons.data);
+		chime_debug_cat(CHIME_LOG_AUDIO, "DTLS certificate verification failed (%u): %s\n", status, reasons.data);
 		gnutls_free(reasons.data);
 		return -1;
 	}
@@ -463,7 +463,7 @@ static int dtls_verify_cb(gnutls_session_t sess)
 static void connect_dtls(ChimeCallAudio *audio, GSocket *s)
 {
 	/* Not that "connected" means anything except that we think we can route to it. */
-	chime_debug("UDP socket connected\n");
+	chime_debug_cat(CHIME_LOG_AUDIO, "UDP socket connected\n");
 
 	audio->dtls_source = g_datagram_based_create_source(G_DATAGRAM_BASED(s), G_IO_IN, audio->cancel);
 	audio->dtls_sock = s;
@@ -511,7 +511,7 @@ static void connect_dtls(ChimeCallAudio *audio, GSocket *s)
 	gnutls_dtls_set_mtu(audio->dtls_sess, CHIME_DTLS_MTU);
 
 	if (gnutls_handshake(audio->dtls_sess) != GNUTLS_E_AGAIN) {
-		chime_debug("Initial DTLS handshake failed\n");
+		chime_debug_cat(CHIME_LOG_AUDIO, "Initial DTLS handshake failed\n");
 
 		gnutls_deinit(audio->dtls_sess);
 		audio->dtls_sess = NULL;
@@ -533,6 +533,34 @@ static void connect_dtls(ChimeCallAudio *audio, GSocket *s)
 	chime_call_transport_connect_ws(audio);
 }
 
+/* Returns TRUE if it has taken over the connection attempt */
+static gboolean audio_dtls_addr(ChimeCallAudio *audio, GSocketAddress *addr)
+{
+	GInetAddress *inet = g_inet_socket_address_get_address(G_INET_SOCKET_ADDRESS(addr));
+	guint16 port = g_inet_socket_address_get_port(G_INET_SOCKET_ADDRESS(addr));
+	gchar *addr_str = g_inet_address_to_string(inet);
+
+	chime_debug_cat(CHIME_LOG_AUDIO, "DTLS address %s:%d\n", addr_str, port);
+	g_free(addr_str);
+
+	GSocket *s = g_socket_new(g_socket_address_get_family(addr), G_SOCKET_TYPE_DATAGRAM,
+				  G_SOCKET_PROTOCOL_UDP, NULL);
+	if (!s)
+		return FALSE;
+
+	g_socket_set_blocking(s, FALSE);
+
+	/* This doesn't block as it's a UDP connect */
+	if (g_socket_connect(s, addr, NULL, NULL)) {
+		connect_dtls(audio, s);
+		return TRUE;
+	}
+
+	/* Failed to connect (i.e. we can't route to it. */
+	g_object_unref(s);
+	return FALSE;
+}
+
 static void audio_dtls_one(GObject *obj, GAsyncResult *res, gpointer user_data)
 {
 	GSocketAddressEnumerator *enumerator = G_SOCKET_ADDRESS_ENUMERATOR(obj);
@@ -549,35 +577,15 @@ static void audio_dtls_one(GObject *obj, GAsyncResult *res, gpointer user_data)
 		return;
 	}
 
-	GInetAddress *inet = g_inet_socket_address_get_address(G_INET_SOCKET_ADDRESS(addr));
-	guint16 port = g_inet_socket_address_get_port(G_INET_SOCKET_ADDRESS(addr));
-	gchar *addr_str = g_inet_address_to_string(inet);
-
-	chime_debug("DTLS address %s:%d\n", addr_str, port);
-	g_free(addr_str);
-
-	GSocket *s = g_socket_new(g_socket_address_get_family(addr), G_SOCKET_TYPE_DATAGRAM,
-				  G_SOCKET_PROTOCOL_UDP, NULL);
-	if (!s)
-		goto err;
-
-	g_socket_set_blocking(s, FALSE);
-
-	/* This doesn't block as it's a UDP connect */
-	if (g_socket_connect(s, addr, NULL, NULL)) {
+	if (audio_dtls_addr(audio, addr)) {
 		/* Ideally, we should keep the enumerator around and try the next
 		   address if the actual DTLS connection fails. */
 		g_object_unref(addr);
 		g_object_unref(enumerator);
-
-		connect_dtls(audio, s);
 		return;
 	}
 
-	/* Failed to connect (i.e. we can't route to it. Try next addresses... */
-	g_object_unref(s);
-
- err:
+	/* Try next addresses... */
 	g_object_unref(addr);
 	g_socket_address_enumerator_next_async(enumerator, audio->cancel,
 					       (GAsyncReadyCallback)audio_dtls_one, audio);
@@ -592,6 +600,13 @@ void chime_call_transport_connect(ChimeCallAudio *audio, gboolean silent)
 
 	chime_call_audio_set_state(audio, CHIME_AUDIO_STATE_CONNECTING, NULL);
 
+	/* If the meeting was warmed up, we already know where to go */
+	GList *l;
+	for (l = chime_call_get_media_addrs(audio->call); l; l = l->next) {
+		if (audio_dtls_addr(audio, l->data))
+			return;
+	}
+
 	GSocketConnectable *addr = g_network_address_parse(chime_call_get_media_host(audio->call),
 							   0, NULL);
 	if (!addr) {
@@ -608,7 +623,7 @@ void chime_call_transport_connect(ChimeCallAudio *audio, gboolean silent)
 
 static void on_final_audiows_close(SoupWebsocketConnection *ws, gpointer _unused)
 {
-	chime_debug("audio ws close\n");
+	chime_debug_cat(CHIME_LOG_AUDIO, "audio ws close\n");
 	g_object_unref(ws);
 }
 
@@ -680,7 +695,7 @@ void chime_call_transport_send_packet(ChimeCallAudio *audio, enum xrp_pkt_type t
 	hdr->type = htons(type);
 	hdr->len = htons(len);
 	protobuf_c_message_pack(message, (void *)(hdr + 1));
-	if (getenv("CHIME_AUDIO_DEBUG")) {
+	if (chime_log_enabled(CHIME_LOG_AUDIO_PACKETS)) {
 		printf("sending protobuf of len %zd\n", len);
 		hexdump(hdr, len);
 	}
@@ -75,6 +75,11 @@ struct _ChimeCall {
 	ChimeCallAudio *audio;
 	ChimeCallScreen *screen;
 	guint opens;
+
+	/* Pre-resolved media_host, from chime_call_warm_up() */
+	gchar *media_addrs_host;
+	GList *media_addrs;
+	gboolean resolving;
 };
 
 G_DEFINE_TYPE(ChimeCall, chime_call, CHIME_TYPE_OBJECT)
@@ -117,6 +122,10 @@ chime_call_dispose(GObject *object)
 
 	g_clear_pointer(&self->participants, g_hash_table_destroy);
 
+	g_list_free_full(self->media_addrs, g_object_unref);
+	self->media_addrs = NULL;
+	g_clear_pointer(&self->media_addrs_host, g_free);
+
 	G_OBJECT_CLASS(chime_call_parent_class)->dispose(object);
 }
 
@@ -127,6 +136,8 @@ chime_call_finalize(GObject *object)
 
 	CHIME_PROPS_FREE
 
+	chime_mem_account(CHIME_MEM_CALL, -(gssize)sizeof(*self), -1);
+
 	G_OBJECT_CLASS(chime_call_parent_class)->finalize(object);
 }
 
@@ -201,6 +212,8 @@ static void chime_call_class_init(ChimeCallClass *klass)
 
 static void chime_call_init(ChimeCall *self)
 {
+	chime_mem_account(CHIME_MEM_CALL, sizeof(*self), 1);
+
 	self->participants = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_participant);
 }
 
@@ -341,6 +354,8 @@ static void free_participant(void *_p)
 	free(p->full_name);
 	free(p->email);
 	free(p);
+
+	chime_mem_account(CHIME_MEM_CALL_PARTICIPANT, -(gssize)sizeof(*p), -1);
 }
 
 static gboolean parse_participant(ChimeConnection *cxn, ChimeCall *call, JsonNode *p,
@@ -367,6 +382,7 @@ static gboolean parse_participant(ChimeConnection *cxn, ChimeCall *call, JsonNod
 	ChimeCallParticipant *cp = g_hash_table_lookup(call->participants, (void *)participant_id);
 	if (!cp) {
 		cp = g_new0(ChimeCallParticipant, 1);
+		chime_mem_account(CHIME_MEM_CALL_PARTICIPANT, sizeof(*cp), 1);
 		cp->volume = -128;
 		cp->participant_id = g_strdup(participant_id);
 		cp->participant_type = g_strdup(participant_type);
@@ -497,13 +513,16 @@ ChimeCall *chime_connection_parse_call(ChimeConnection *cxn, JsonNode *node,
 		return call;
 	}
 
-	if (alert_body && g_strcmp0(alert_body, chime_call_get_alert_body(call))) {
+	/* Emit the notifications together, once the call is consistent */
+	g_object_freeze_notify(G_OBJECT(call));
+
+	if (alert_body && g_strcmp0(alert_body, chime_call_get_alert_body(call)))
 		chime_object_rename(CHIME_OBJECT(call), alert_body);
-		g_object_notify(G_OBJECT(call), "name");
-	}
 
 	CHIME_PROPS_UPDATE
 
+	g_object_thaw_notify(G_OBJECT(call));
+
 	return g_object_ref(call);
 }
 
@@ -567,6 +586,84 @@ void chime_connection_open_call(ChimeConnection *cxn, ChimeCall *call, gboolean
 	}
 }
 
+struct media_resolve {
+	ChimeCall *call;
+	gchar *host;
+	guint16 port;
+};
+
+static void media_host_resolved(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	struct media_resolve *mr = user_data;
+	ChimeCall *call = mr->call;
+	GError *error = NULL;
+
+	call->resolving = FALSE;
+
+	GList *inets = g_resolver_lookup_by_name_finish(G_RESOLVER(source), result, &error);
+	if (!inets) {
+		chime_debug_cat(CHIME_LOG_AUDIO, "Failed to resolve media host %s: %s\n", mr->host, error->message);
+		g_clear_error(&error);
+		g_free(mr->host);
+		goto out;
+	}
+
+	g_list_free_full(call->media_addrs, g_object_unref);
+	call->media_addrs = NULL;
+	g_free(call->media_addrs_host);
+	call->media_addrs_host = mr->host;
+
+	GList *l;
+	for (l = inets; l; l = l->next)
+		call->media_addrs = g_list_append(call->media_addrs,
+						  g_inet_socket_address_new(l->data, mr->port));
+	g_resolver_free_addresses(inets);
+
+	chime_debug_cat(CHIME_LOG_AUDIO, "Resolved media host %s in advance\n", call->media_addrs_host);
+ out:
+	g_object_unref(call);
+	g_free(mr);
+}
+
+/* Look up the media host ahead of joining, so the audio transport
+ * can go straight to the DTLS handshake. */
+void chime_call_warm_up(ChimeCall *call)
+{
+	g_return_if_fail(CHIME_IS_CALL(call));
+
+	if (call->resolving || !call->media_host ||
+	    !g_strcmp0(call->media_addrs_host, call->media_host))
+		return;
+
+	GSocketConnectable *addr = g_network_address_parse(call->media_host, 0, NULL);
+	if (!addr)
+		return;
+
+	struct media_resolve *mr = g_new0(struct media_resolve, 1);
+	mr->call = g_object_ref(call);
+	mr->host = g_strdup(call->media_host);
+	mr->port = g_network_address_get_port(G_NETWORK_ADDRESS(addr));
+	call->resolving = TRUE;
+
+	GResolver *resolver = g_resolver_get_default();
+	g_resolver_lookup_by_name_async(resolver,
+					g_network_address_get_hostname(G_NETWORK_ADDRESS(addr)),
+					NULL, media_host_resolved, mr);
+	g_object_unref(resolver);
+	g_object_unref(addr);
+}
+
+/* Returns the pre-resolved addresses, if they're still for the current media_host */
+GList *chime_call_get_media_addrs(ChimeCall *call)
+{
+	g_return_val_if_fail(CHIME_IS_CALL(call), NULL);
+
+	if (g_strcmp0(call->media_addrs_host, call->media_host))
+		return NULL;
+
+	return call->media_addrs;
+}
+
 void chime_call_set_silent(ChimeCall *call, gboolean silent)
 {
 	if (call->audio)
@@ -589,7 +686,7 @@ void chime_call_set_local_mute(ChimeCall *call, gboolean muted)
 
 void chime_call_audio_set_state(ChimeCallAudio *audio, ChimeAudioState state, const gchar *message)
 {
-	chime_debug("Audio state %d (was %d), msg %s\n", state, audio->state, message);
+	chime_debug_cat(CHIME_LOG_AUDIO, "Audio state %d (was %d), msg %s\n", state, audio->state, message);
 
 	if (audio->state == state)
 		return;
@@ -600,7 +697,7 @@ void chime_call_audio_set_state(ChimeCallAudio *audio, ChimeAudioState state, co
 
 void chime_call_screen_set_state(ChimeCallScreen *screen, ChimeScreenState state, const gchar *message)
 {
-	chime_debug("Screen state %d (was %d), msg %s\n", state, screen->state, message);
+	chime_debug_cat(CHIME_LOG_SCREEN, "Screen state %d (was %d), msg %s\n", state, screen->state, message);
 
 	if (screen->state == state)
 		return;
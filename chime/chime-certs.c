@@ -32,28 +32,30 @@ static const char *cert_filenames[NR_CERTS] = {
 	"SFS_Root_CA_G2.pem",
 };
 
-static GTlsCertificate *certs[NR_CERTS];
-
-GSList *chime_cert_list(void)
+/* Loaded once and shared by every connection in the process */
+const GSList *chime_cert_list(void)
 {
+	static gsize inited;
+	static GSList *certs;
 	int i;
-	GSList *ret = NULL;
+
+	if (!g_once_init_enter(&inited))
+		return certs;
 
 	for (i=0; i < NR_CERTS; i++) {
-		if (certs[i]) {
-			g_object_ref(certs[i]);
-		} else {
-			GError *error = NULL;
-			gchar *filename = g_build_filename(CHIME_CERTS_DIR, cert_filenames[i], NULL);
-			certs[i] = g_tls_certificate_new_from_file(filename, &error);
-			if (!certs[i]) {
-				chime_debug("Failed to load %s: %s\n", cert_filenames[1], error->message);
-				g_clear_error(&error);
-				continue;
-			}
-			g_object_add_weak_pointer(G_OBJECT(certs[i]), (gpointer *)&certs[i]);
+		GError *error = NULL;
+		gchar *filename = g_build_filename(CHIME_CERTS_DIR, cert_filenames[i], NULL);
+		GTlsCertificate *cert = g_tls_certificate_new_from_file(filename, &error);
+
+		g_free(filename);
+		if (!cert) {
+			chime_debug("Failed to load %s: %s\n", cert_filenames[i], error->message);
+			g_clear_error(&error);
+			continue;
 		}
-		ret = g_slist_prepend(ret, certs[i]);
+		certs = g_slist_prepend(certs, cert);
 	}
-	return ret;
+
+	g_once_init_leave(&inited, 1);
+	return certs;
 }
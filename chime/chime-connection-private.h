@@ -82,11 +82,68 @@ typedef enum {
 	CHIME_SYNC_FETCHING,
 } ChimeSyncState;
 
+/* chime-metrics.c */
+enum {
+	CHIME_METRIC_HTTP_REQUESTS,
+	CHIME_METRIC_HTTP_ERRORS,
+	CHIME_METRIC_HTTP_RENEWALS,
+	CHIME_METRIC_HTTP_REFRESHES,
+	CHIME_METRIC_HTTP_DURATION,
+	CHIME_METRIC_JUGG_MESSAGES,
+	CHIME_METRIC_JUGG_UNHANDLED,
+	CHIME_METRIC_SYNC_CONTACTS,
+	CHIME_METRIC_SYNC_ROOMS,
+	CHIME_METRIC_SYNC_CONVERSATIONS,
+	CHIME_METRIC_AUDIO_RX_PACKETS,
+	CHIME_METRIC_AUDIO_RX_DROPPED,
+	CHIME_METRIC_AUDIO_TX_PACKETS,
+	CHIME_METRIC_LAST
+};
+
+#define CHIME_METRIC_BUCKETS 28	/* Powers of two up to ~2 minutes in µs */
+
+struct chime_metric {
+	gint64 sum;		/* The value, for counters */
+	guint64 count;
+	gint64 max;
+	guint64 buckets[CHIME_METRIC_BUCKETS];
+};
+
 #define CHIME_DEVICE_CAP_PUSH_DELIVERY_RECEIPTS		(1<<1)
 #define CHIME_DEVICE_CAP_PRESENCE_PUSH			(1<<2)
 #define CHIME_DEVICE_CAP_WEBINAR			(1<<3)
 #define CHIME_DEVICE_CAP_PRESENCE_SUBSCRIPTION		(1<<4)
 
+/* Points in a request's life recorded by chime-http-trace.c */
+enum {
+	CHIME_TRACE_EV_RESOLVING,
+	CHIME_TRACE_EV_RESOLVED,
+	CHIME_TRACE_EV_CONNECTING,
+	CHIME_TRACE_EV_CONNECTED,
+	CHIME_TRACE_EV_TLS_START,
+	CHIME_TRACE_EV_TLS_DONE,
+	CHIME_TRACE_EV_STARTING,
+	CHIME_TRACE_EV_WROTE_BODY,
+	CHIME_TRACE_EV_GOT_HEADERS,
+	CHIME_TRACE_EV_GOT_BODY,
+	CHIME_TRACE_EV_PARSE_START,
+	CHIME_TRACE_EV_PARSE_DONE,
+	CHIME_TRACE_EVENTS
+};
+
+/* ... and the phases derived from them */
+enum {
+	CHIME_TRACE_QUEUE,
+	CHIME_TRACE_DNS,
+	CHIME_TRACE_CONNECT,
+	CHIME_TRACE_TLS,
+	CHIME_TRACE_SEND,
+	CHIME_TRACE_TTFB,
+	CHIME_TRACE_BODY,
+	CHIME_TRACE_PARSE,
+	CHIME_TRACE_PHASES
+};
+
 /* SoupMessage handling for Chime communication, with retry on re-auth
  * and JSON parsing. XX: MAke this a proper superclass of SoupMessage */
 struct chime_msg {
@@ -95,17 +152,37 @@ struct chime_msg {
 	gpointer cb_data;
 	SoupMessage *msg;
 	gboolean auto_renew;
+	gint64 queued_time;
+	gboolean traced;
+	gint64 trace[CHIME_TRACE_EVENTS];
+
+	/* The response, once parsed */
+	gboolean parsed;
+	gboolean cancelled;	/* Disconnected while waiting to be dispatched */
+	JsonParser *parser;
+	JsonNode *node;
 };
 
 typedef struct {
 	ChimeConnectionState state;
-	GSList *amazon_cas;
 
 	gchar *server;
 	gchar *device_token;
 	gchar *session_token;
 
+	/* Session token lifecycle; see schedule_token_refresh() */
+	gint64 token_time;		/* When we got it (real time), or zero */
+	gint64 token_lifetime;		/* Learned from 401s (µs), or zero */
+	gboolean token_renewing;
+	gboolean token_holding;		/* New requests wait for the renewal */
+	guint token_refresh_timer;
+	guint token_hold_timer;
+
+	gboolean watchdog_started;
+
 	gboolean jugg_online, contacts_online, rooms_online, convs_online, meetings_online;
+	gint64 connect_start;
+	gint64 online_time[CHIME_ONLINE_LAST];	/* µs after connect_start, or -1 */
 
 	/* Service config */
 	JsonNode *reg_node;
@@ -130,10 +207,13 @@ typedef struct {
 	const gchar *conference_url;
 
 	SoupSession *soup_sess;
+	gboolean shared_session;	/* With other connections */
+	SoupMessage *ws_connect_msg;
 
 	/* Messages queued for resubmission */
 	GQueue *msgs_queued;
 	GQueue *msgs_pending_auth;
+	GQueue *msgs_parsing;		/* Completed, waiting to be dispatched in order */
 
 	/* Juggernaut */
 	SoupWebsocketConnection *ws_conn;
@@ -145,27 +225,134 @@ typedef struct {
 	/* Contacts */
 	ChimeObjectCollection contacts;
 	ChimeSyncState contacts_sync;
+	gint64 contacts_sync_start;
 	GSList *contacts_needed;
 	guint contacts_src_id;
 
 	/* Rooms */
 	ChimeObjectCollection rooms;
+	GPtrArray *room_dir;		/* Live rooms, sorted by name */
+	GHashTable *pending_rooms;	/* RoomId → messages awaiting the room */
 	ChimeSyncState rooms_sync;
+	gint64 rooms_sync_start;
 
 	/* Conversations */
 	ChimeObjectCollection conversations;
 	ChimeSyncState conversations_sync;
+	gint64 conversations_sync_start;
+
+	/* Unread activity in rooms and conversations */
+	GHashTable *activity;		/* ChimeObject → struct chime_activity */
+	GSequence *activity_index;	/* Those with unread activity, newest first */
 
 	/* Meetings */
 	ChimeObjectCollection meetings;
+	GHashTable *meetings_by_pin;	/* passcode and display ID → meeting */
+	GHashTable *joinable_meetings;	/* Set of live meetings */
 	ChimeObjectCollection calls;
+
+	/* Metrics */
+	GMutex metrics_lock;
+	struct chime_metric metrics[CHIME_METRIC_LAST];
+	GSocketService *metrics_service;
+	gchar *metrics_path;
+	GHashTable *http_endpoints;	/* "METHOD host /path/{id}" → stats */
+
+	GString *json_buf;		/* Reused by chime_connection_json_buf() */
+
+	gchar **mention_keywords;
+	struct chime_mention_matcher *mention_matcher;
 } ChimeConnectionPrivate;
 
 #define CHIME_CONNECTION_GET_PRIVATE(o) \
 	(G_TYPE_INSTANCE_GET_PRIVATE ((o), CHIME_TYPE_CONNECTION, \
 				      ChimeConnectionPrivate))
 
-#define chime_debug(...) do { if (getenv("CHIME_DEBUG")) printf(__VA_ARGS__); } while (0)
+/* chime-log.c */
+enum {
+	CHIME_LOG_MISC = 1 << 0,
+	CHIME_LOG_JUGG = 1 << 1,
+	CHIME_LOG_HTTP = 1 << 2,
+	CHIME_LOG_SIGNIN = 1 << 3,
+	CHIME_LOG_AUDIO = 1 << 4,
+	CHIME_LOG_SCREEN = 1 << 5,
+	CHIME_LOG_SYNC = 1 << 6,
+	CHIME_LOG_AUDIO_PACKETS = 1 << 7,
+	CHIME_LOG_SCREEN_PACKETS = 1 << 8,
+	CHIME_LOG_MEMORY = 1 << 9,	/* Not a log category; see chime-memory.c */
+	CHIME_LOG_LATENCY = 1 << 10,	/* Also enables chime-watchdog.c */
+};
+
+extern guint chime_log_categories;
+extern ChimeLogLevel chime_log_threshold;
+
+#define chime_log_enabled(cat) G_UNLIKELY(chime_log_categories & (cat))
+#define chime_log_level_enabled(level) ((level) >= chime_log_threshold)
+
+void chime_log_init(void);
+void chime_log_debug(guint category, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+void chime_connection_do_log(ChimeConnection *cxn, guint category, ChimeLogLevel level,
+			     const gchar *format, ...) G_GNUC_PRINTF(4, 5);
+
+/* None of the arguments are evaluated unless the output is wanted */
+#define chime_debug_cat(cat, ...) do {					\
+		if (chime_log_enabled(cat))				\
+			chime_log_debug(cat, __VA_ARGS__);		\
+	} while (0)
+#define chime_debug(...) chime_debug_cat(CHIME_LOG_MISC, __VA_ARGS__)
+
+#define chime_connection_log_cat(cxn, cat, level, ...) do {		\
+		if (chime_log_level_enabled(level) || chime_log_enabled(cat)) \
+			chime_connection_do_log(cxn, cat, level, __VA_ARGS__); \
+	} while (0)
+#define chime_connection_log(cxn, level, ...)				\
+	chime_connection_log_cat(cxn, 0, level, __VA_ARGS__)
+
+void chime_metric_add(ChimeConnection *cxn, guint metric, gint64 delta);
+void chime_metric_observe(ChimeConnection *cxn, guint metric, gint64 usecs);
+#define chime_metric_inc(cxn, metric) chime_metric_add(cxn, metric, 1)
+
+/* chime-http-trace.c */
+void chime_http_trace_start(struct chime_msg *cmsg);
+void chime_http_trace_finish(ChimeConnection *cxn, struct chime_msg *cmsg);
+void chime_http_trace_append_metrics(ChimeConnection *cxn, GString *out);
+
+/* chime-watchdog.c */
+struct chime_scope {
+	const gchar *name;
+	const gchar *detail;
+	gint64 start;
+	gboolean inner_stalled;
+	struct chime_scope *outer;
+};
+
+void chime_scope_enter(struct chime_scope *scope, const gchar *name, const gchar *detail);
+void chime_scope_exit(struct chime_scope *scope);
+gboolean chime_watchdog_start(void);
+void chime_watchdog_stop(void);
+void chime_watchdog_append_metrics(GString *out);
+
+/* chime-activity.c */
+void chime_activity_update(ChimeConnection *cxn, ChimeObject *obj, const gchar *last_sent,
+			   const gchar *last_read, const gchar *last_mentioned);
+void chime_activity_message(ChimeConnection *cxn, ChimeObject *obj, JsonNode *record,
+			    gboolean mention);
+void chime_activity_mark_read(ChimeConnection *cxn, ChimeObject *obj, const gchar *msg_id);
+void chime_destroy_activity(ChimeConnection *cxn);
+
+/* chime-mention.c */
+struct chime_mention_matcher;
+void chime_mention_matcher_free(struct chime_mention_matcher *m);
+
+/* chime-json.c */
+GString *chime_connection_json_buf(ChimeConnection *cxn);
+void chime_json_begin_object(GString *s, const gchar *name);
+void chime_json_end_object(GString *s);
+void chime_json_begin_array(GString *s, const gchar *name);
+void chime_json_end_array(GString *s);
+void chime_json_add_string(GString *s, const gchar *name, const gchar *val);
+void chime_json_add_boolean(GString *s, const gchar *name, gboolean val);
+void chime_json_add_int(GString *s, const gchar *name, gint64 val);
 
 /* chime-websocket.c */
 /* Like the soup_session_ variants, but with the auth retry */
@@ -192,12 +379,16 @@ void chime_connection_new_contact(ChimeConnection *cxn, ChimeContact *contact);
 void chime_connection_new_room(ChimeConnection *cxn, ChimeRoom *room);
 void chime_connection_new_conversation(ChimeConnection *cxn, ChimeConversation *conversation);
 void chime_connection_new_meeting(ChimeConnection *cxn, ChimeMeeting *meeting);
-void chime_connection_log(ChimeConnection *cxn, ChimeLogLevel level, const gchar *format, ...);
+void chime_connection_emit_log(ChimeConnection *cxn, ChimeLogLevel level, const gchar *str);
 void chime_connection_progress(ChimeConnection *cxn, int percent, const gchar *message);
 SoupMessage *chime_connection_queue_http_request(ChimeConnection *self, JsonNode *node,
 						 SoupURI *uri, const gchar *method,
 						 ChimeSoupMessageCallback callback,
 						 gpointer cb_data);
+SoupMessage *chime_connection_queue_http_json(ChimeConnection *self, GString *body,
+					      SoupURI *uri, const gchar *method,
+					      ChimeSoupMessageCallback callback,
+					      gpointer cb_data);
 SoupURI *soup_uri_new_printf(const gchar *base, const gchar *format, ...);
 gboolean parse_notify_pref(JsonNode *node, const gchar *member, ChimeNotifyPref *type);
 gboolean parse_visibility(JsonNode *node, const gchar *member, gboolean *val);
@@ -216,6 +407,7 @@ ChimeContact *chime_connection_parse_contact(ChimeConnection *cxn,
 
 /* chime-juggernaut.c */
 gboolean chime_connection_jugg_send(ChimeConnection *self, JsonNode *node);
+gboolean chime_connection_jugg_send_json(ChimeConnection *self, GString *body);
 
 /* chime-conversation.c */
 void chime_init_conversations(ChimeConnection *cxn);
@@ -254,6 +446,8 @@ ChimeConnection *chime_call_get_connection(ChimeCall *self);
 void chime_connection_close_call(ChimeConnection *cxn, ChimeCall *call);
 void chime_connection_open_call(ChimeConnection *cxn, ChimeCall *call, gboolean muted);
 
+void chime_call_warm_up(ChimeCall *call);
+GList *chime_call_get_media_addrs(ChimeCall *call);
 gboolean chime_call_participant_audio_stats(ChimeCall *call, const gchar *profile_id, int vol, int signal_strength);
 
 
@@ -261,6 +455,11 @@ gboolean chime_call_participant_audio_stats(ChimeCall *call, const gchar *profil
 void chime_initial_login(ChimeConnection *cxn);
 
 /* chime-certs.c */
-GSList *chime_cert_list(void);
+const GSList *chime_cert_list(void);
+
+/* chime-intern.c */
+const gchar *chime_intern(const gchar *str);
+void chime_unintern(const gchar *str);
+gboolean chime_intern_replace(const gchar **field, const gchar *str);
 
 #endif /* __CHIME_CONNECTION_PRIVATE_H__ */
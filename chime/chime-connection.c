@@ -49,10 +49,14 @@ enum {
 
 static guint signals[LAST_SIGNAL];
 
+/* Session token lifetime, as learned by any connection */
+static gint64 known_token_lifetime;
+
 G_DEFINE_QUARK(chime-error-quark, chime_error)
 G_DEFINE_TYPE(ChimeConnection, chime_connection, G_TYPE_OBJECT)
 
 static void soup_msg_cb(SoupSession *soup_sess, SoupMessage *msg, gpointer _cmsg);
+static void schedule_token_refresh(ChimeConnection *self);
 
 static void
 chime_connection_finalize(GObject *object)
@@ -63,6 +67,25 @@ chime_connection_finalize(GObject *object)
 	g_free(priv->session_token);
 	g_free(priv->device_token);
 	g_free(priv->server);
+	g_mutex_clear(&priv->metrics_lock);
+	/* Each entry holds a reference on us */
+	g_warn_if_fail(g_queue_is_empty(priv->msgs_parsing));
+	g_queue_free(priv->msgs_parsing);
+	if (priv->http_endpoints)
+		g_hash_table_destroy(priv->http_endpoints);
+	if (priv->json_buf)
+		g_string_free(priv->json_buf, TRUE);
+	g_strfreev(priv->mention_keywords);
+	if (priv->mention_matcher)
+		chime_mention_matcher_free(priv->mention_matcher);
+
+	if (priv->watchdog_started)
+		chime_watchdog_stop();
+
+	if (priv->token_refresh_timer)
+		g_source_remove(priv->token_refresh_timer);
+	if (priv->token_hold_timer)
+		g_source_remove(priv->token_hold_timer);
 
 	chime_connection_log(self, CHIME_LOGLVL_MISC, "Connection finalized: %p\n", self);
 
@@ -72,8 +95,19 @@ chime_connection_finalize(GObject *object)
 static void
 cmsg_free(struct chime_msg *cmsg)
 {
+	g_signal_handlers_disconnect_by_data(cmsg->msg, cmsg);
+	g_clear_object(&cmsg->parser);
 	g_object_unref(cmsg->msg);
 	g_free(cmsg);
+	chime_mem_account(CHIME_MEM_HTTP_MSG, -(gssize)sizeof(*cmsg), -1);
+}
+
+static void
+cancel_parsing_msg(gpointer _cmsg, gpointer unused)
+{
+	struct chime_msg *cmsg = _cmsg;
+
+	cmsg->cancelled = TRUE;
 }
 
 void
@@ -84,12 +118,29 @@ chime_connection_disconnect(ChimeConnection    *self)
 	chime_connection_log(self, CHIME_LOGLVL_MISC, "Disconnecting connection: %p\n", self);
 
 	if (priv->soup_sess) {
-		soup_session_abort(priv->soup_sess);
+		if (priv->shared_session) {
+			/* Only cancel our own messages. Their callbacks may run
+			 * now or from the main loop later, so work from a copy
+			 * and skip any which have finished in the meantime. */
+			GList *l, *msgs = g_list_copy(priv->msgs_queued->head);
+			for (l = msgs; l; l = l->next) {
+				struct chime_msg *cmsg = l->data;
+				if (g_queue_find(priv->msgs_queued, cmsg))
+					soup_session_cancel_message(priv->soup_sess, cmsg->msg,
+								    SOUP_STATUS_CANCELLED);
+			}
+			g_list_free(msgs);
+			if (priv->ws_connect_msg)
+				soup_session_cancel_message(priv->soup_sess, priv->ws_connect_msg,
+							    SOUP_STATUS_CANCELLED);
+		} else
+			soup_session_abort(priv->soup_sess);
 		g_clear_object(&priv->soup_sess);
 	}
 
 	chime_destroy_meetings(self);
 	chime_destroy_calls(self);
+	chime_destroy_activity(self);
 	chime_destroy_rooms(self);
 	chime_destroy_conversations(self);
 	chime_destroy_contacts(self);
@@ -101,10 +152,22 @@ chime_connection_disconnect(ChimeConnection    *self)
 		g_queue_free_full(priv->msgs_pending_auth, (GDestroyNotify)cmsg_free);
 		priv->msgs_pending_auth = NULL;
 	}
+	if (priv->token_refresh_timer) {
+		g_source_remove(priv->token_refresh_timer);
+		priv->token_refresh_timer = 0;
+	}
+	if (priv->token_hold_timer) {
+		g_source_remove(priv->token_hold_timer);
+		priv->token_hold_timer = 0;
+	}
+	priv->token_renewing = priv->token_holding = FALSE;
 	if (priv->msgs_queued) {
 		g_queue_free(priv->msgs_queued);
 		priv->msgs_queued = NULL;
 	}
+	/* Responses still being parsed, and those waiting behind them, will
+	 * be handed over as cancelled rather than acted upon. */
+	g_queue_foreach(priv->msgs_parsing, cancel_parsing_msg, NULL);
 
 	if (priv->state != CHIME_STATE_DISCONNECTED)
 		g_signal_emit(self, signals[DISCONNECTED], 0, NULL);
@@ -120,8 +183,7 @@ chime_connection_dispose(GObject *object)
 	if (priv->state != CHIME_STATE_DISCONNECTED)
 		chime_connection_disconnect(self);
 
-	g_slist_free_full(priv->amazon_cas, g_object_unref);
-	priv->amazon_cas = NULL;
+	chime_connection_serve_metrics(self, NULL, NULL);
 	chime_connection_log(self, CHIME_LOGLVL_MISC, "Connection disposed: %p\n", self);
 
 	G_OBJECT_CLASS(chime_connection_parent_class)->dispose(object);
@@ -190,6 +252,8 @@ chime_connection_class_init(ChimeConnectionClass *klass)
 
         g_type_class_add_private (klass, sizeof (ChimeConnectionPrivate));
 
+	chime_log_init();
+
 	object_class->finalize = chime_connection_finalize;
 	object_class->dispose = chime_connection_dispose;
 	object_class->get_property = chime_connection_get_property;
@@ -309,11 +373,8 @@ void chime_connection_fail(ChimeConnection *cxn, gint code, const gchar *format,
 }
 
 static void
-req_started_cb(SoupSession *sess, SoupMessage *msg, SoupSocket *sock, gpointer _cxn)
+req_started_cb(SoupSession *sess, SoupMessage *msg, SoupSocket *sock, gpointer ignored)
 {
-	ChimeConnection *cxn = CHIME_CONNECTION(_cxn);
-	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
-
 	if (!soup_socket_is_ssl(sock))
 		return;
 
@@ -335,7 +396,7 @@ req_started_cb(SoupSession *sess, SoupMessage *msg, SoupSocket *sock, gpointer _
 		GTlsCertificate *cert;
 		g_object_get(sock, "tls-certificate", &cert, NULL);
 
-		GSList *l = priv->amazon_cas;
+		const GSList *l = chime_cert_list();
 		while (l && cert_errors) {
 			cert_errors = g_tls_certificate_verify(cert, ident, G_TLS_CERTIFICATE(l->data));
 			l = l->next;
@@ -343,7 +404,7 @@ req_started_cb(SoupSession *sess, SoupMessage *msg, SoupSocket *sock, gpointer _
 		g_object_unref(ident);
 
 		if (!cert_errors) {
-			chime_debug("Allow Amazon CA for %s\n", soup_uri_get_host(uri));
+			chime_debug_cat(CHIME_LOG_HTTP, "Allow Amazon CA for %s\n", soup_uri_get_host(uri));
 			return;
 		}
 	}
@@ -352,30 +413,93 @@ req_started_cb(SoupSession *sess, SoupMessage *msg, SoupSocket *sock, gpointer _
 	soup_session_cancel_message(sess, msg, SOUP_STATUS_SSL_FAILED);
 }
 
-static void
-chime_connection_init(ChimeConnection *self)
+static SoupSession *new_soup_session(void)
 {
-	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
-	priv->soup_sess = soup_session_new();
-	priv->amazon_cas = chime_cert_list();
+	SoupSession *sess = soup_session_new();
 
-	if (getenv("CHIME_DEBUG") && atoi(getenv("CHIME_DEBUG")) > 0) {
+	if (chime_log_enabled(CHIME_LOG_HTTP)) {
 		SoupLogger *l = soup_logger_new(SOUP_LOGGER_LOG_BODY, -1);
-		soup_session_add_feature(priv->soup_sess, SOUP_SESSION_FEATURE(l));
+		soup_session_add_feature(sess, SOUP_SESSION_FEATURE(l));
 		g_object_unref(l);
 	}
 
 	const gchar *https_aliases[2] = { "wss", NULL };
-	g_object_set(priv->soup_sess, "https-aliases", https_aliases, NULL);
+	g_object_set(sess, "https-aliases", https_aliases, NULL);
 
 	/* Unset ssl-strict and manually check, so that we can allow
 	 * the Amazon internal CAs. The media endpoints may use those. */
-	g_object_set(priv->soup_sess, "ssl-strict", FALSE, NULL);
-	g_signal_connect(G_OBJECT(priv->soup_sess), "request-started", G_CALLBACK(req_started_cb), self);
+	g_object_set(sess, "ssl-strict", FALSE, NULL);
+	g_signal_connect(G_OBJECT(sess), "request-started", G_CALLBACK(req_started_cb), NULL);
+
+	return sess;
+}
+
+/*
+ * By default each connection has its own SoupSession. Processes which run
+ * many accounts can have them share one instead, with a single connection
+ * pool and TLS session cache. Nothing in the session is per-account: the
+ * session token goes in each message's own Cookie header.
+ */
+#define SHARED_MAX_CONNS 256
+#define SHARED_MAX_CONNS_PER_HOST 64
+
+static gboolean share_sessions;
+static SoupSession *shared_soup_sess;
+
+/**
+ * chime_set_shared_sessions:
+ * @share: whether to share
+ *
+ * Sets whether connections created from now on will share a single
+ * HTTP session. Existing connections are unaffected.
+ */
+void chime_set_shared_sessions(gboolean share)
+{
+	share_sessions = share;
+}
+
+static SoupSession *get_soup_session(gboolean shared)
+{
+	if (!shared)
+		return new_soup_session();
+
+	if (shared_soup_sess)
+		return g_object_ref(shared_soup_sess);
+
+	/* Freed when the last connection using it lets go */
+	shared_soup_sess = new_soup_session();
+	g_object_set(shared_soup_sess, "max-conns", SHARED_MAX_CONNS,
+		     "max-conns-per-host", SHARED_MAX_CONNS_PER_HOST, NULL);
+	g_object_add_weak_pointer(G_OBJECT(shared_soup_sess), (gpointer *)&shared_soup_sess);
 
+	return shared_soup_sess;
+}
+
+static void reset_online_times(ChimeConnectionPrivate *priv)
+{
+	int i;
+
+	for (i = 0; i < CHIME_ONLINE_LAST; i++)
+		priv->online_time[i] = -1;
+}
+
+static void
+chime_connection_init(ChimeConnection *self)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
+
+	priv->shared_session = share_sessions;
+	priv->soup_sess = get_soup_session(share_sessions);
+
+	priv->watchdog_started = chime_watchdog_start();
+
+	priv->token_lifetime = known_token_lifetime;
 	priv->msgs_pending_auth = g_queue_new();
 	priv->msgs_queued = g_queue_new();
+	priv->msgs_parsing = g_queue_new();
 	priv->state = CHIME_STATE_DISCONNECTED;
+	reset_online_times(priv);
+	g_mutex_init(&priv->metrics_lock);
 }
 
 #define SIGNIN_DEFAULT "https://signin.id.ue1.app.chime.aws/"
@@ -509,6 +633,8 @@ static void register_cb(ChimeConnection *self, SoupMessage *msg,
 				      _("Failed to process registration response"));
 		return;
 	}
+	/* We may have been disconnected since we got the token */
+	schedule_token_refresh(self);
 
 	chime_init_juggernaut(self);
 
@@ -526,6 +652,20 @@ static void register_cb(ChimeConnection *self, SoupMessage *msg,
 void chime_connection_calculate_online(ChimeConnection *self)
 {
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
+	gboolean online[CHIME_ONLINE_LAST] = {
+		[CHIME_ONLINE_JUGG] = priv->jugg_online,
+		[CHIME_ONLINE_CONTACTS] = priv->contacts_online,
+		[CHIME_ONLINE_ROOMS] = priv->rooms_online,
+		[CHIME_ONLINE_CONVERSATIONS] = priv->convs_online,
+		[CHIME_ONLINE_MEETINGS] = priv->meetings_online,
+	};
+	int i;
+
+	/* Only the first time each comes online counts, not reconnects */
+	for (i = 0; i < CHIME_ONLINE_LAST; i++) {
+		if (online[i] && priv->online_time[i] < 0)
+			priv->online_time[i] = g_get_monotonic_time() - priv->connect_start;
+	}
 
 	if (priv->contacts_online && priv->rooms_online &&
 	    priv->convs_online && priv->jugg_online && priv->meetings_online) {
@@ -543,6 +683,8 @@ chime_connection_connect(ChimeConnection    *self)
 		return;
 
 	priv->state = CHIME_STATE_CONNECTING;
+	priv->connect_start = g_get_monotonic_time();
+	reset_online_times(priv);
 
 	if (!priv->session_token || !*priv->session_token) {
 		priv->state = CHIME_STATE_DISCONNECTED;
@@ -580,18 +722,13 @@ chime_connection_set_device_status_async(ChimeConnection    *self,
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
 
 	GTask *task = g_task_new(self, cancellable, callback, user_data);
-	JsonBuilder *builder = json_builder_new();
-	builder = json_builder_begin_object(builder);
-	builder = json_builder_set_member_name(builder, "Status");
-	builder = json_builder_add_string_value(builder, status);
-	builder = json_builder_end_object(builder);
-	JsonNode *node = json_builder_get_root(builder);
+	GString *body = chime_connection_json_buf(self);
+	chime_json_begin_object(body, NULL);
+	chime_json_add_string(body, "Status", status);
+	chime_json_end_object(body);
 
 	SoupURI *uri = soup_uri_new_printf(priv->presence_url, "/devicestatus");
-	chime_connection_queue_http_request(self, node, uri, "PUT", set_device_status_cb, task);
-
-	json_node_unref(node);
-	g_object_unref(builder);
+	chime_connection_queue_http_json(self, body, uri, "PUT", set_device_status_cb, task);
 }
 
 gboolean
@@ -626,24 +763,16 @@ chime_connection_set_presence_async(ChimeConnection    *self,
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
 
 	GTask *task = g_task_new(self, cancellable, callback, user_data);
-	JsonBuilder *builder = json_builder_new();
-	builder = json_builder_begin_object(builder);
-	if (availability) {
-		builder = json_builder_set_member_name(builder, "ManualAvailability");
-		builder = json_builder_add_string_value(builder, availability);
-	}
-	if (visibility) {
-		builder = json_builder_set_member_name(builder, "PresenceVisibility");
-		builder = json_builder_add_string_value(builder, visibility);
-	}
-	builder = json_builder_end_object(builder);
-	JsonNode *node = json_builder_get_root(builder);
+	GString *body = chime_connection_json_buf(self);
+	chime_json_begin_object(body, NULL);
+	if (availability)
+		chime_json_add_string(body, "ManualAvailability", availability);
+	if (visibility)
+		chime_json_add_string(body, "PresenceVisibility", visibility);
+	chime_json_end_object(body);
 
 	SoupURI *uri = soup_uri_new_printf(priv->presence_url, "/presencesettings");
-	chime_connection_queue_http_request(self, node, uri, "POST", set_presence_cb, task);
-
-	json_node_unref(node);
-	g_object_unref(builder);
+	chime_connection_queue_http_json(self, body, uri, "POST", set_presence_cb, task);
 }
 
 gboolean
@@ -676,40 +805,135 @@ chime_connection_set_session_token(ChimeConnection *self,
 	if (g_strcmp0(priv->session_token, sess_tok)) {
 		g_free(priv->session_token);
 		priv->session_token = g_strdup(sess_tok);
+		priv->token_time = sess_tok ? g_get_real_time() : 0;
+		schedule_token_refresh(self);
 		g_object_notify_by_pspec(G_OBJECT(self), props[PROP_SESSION_TOKEN]);
 	}
 }
 
-/* If we get an auth failure on a standard request, we automatically attempt
- * to renew the authentication token and resubmit the request. */
-static void renew_cb(ChimeConnection *self, SoupMessage *msg,
-		     JsonNode *node, gpointer _unused)
+/*
+ * Session tokens expire, and every request which finds that out with a
+ * 401 costs a failed round trip before it's retried with a new token.
+ * The server doesn't tell us how long they last, so we learn it from the
+ * age of the token at its first 401, and thereafter renew each token in
+ * the background when most of that time has passed. Ages are in wall
+ * clock time, since tokens keep expiring while the machine is suspended;
+ * the timer for the renewal only wakes us to check the time, since its
+ * own clock may not have counted the suspended time. New requests are
+ * held for a moment while a renewal happens, rather than being sent with
+ * a token which is about to be replaced; if it takes longer than that
+ * they go anyway, since the old token is still good.
+ *
+ * Requests which do get a 401 (or which are queued after one, while the
+ * renewal is in progress) wait in msgs_pending_auth as before.
+ */
+
+/* Renew once this much of the token's lifetime has passed */
+#define TOKEN_REFRESH_PERCENT 80
+/* Don't learn from a token which was revoked, rather than expired */
+#define TOKEN_MIN_LIFETIME (5 * 60 * G_USEC_PER_SEC)
+/* How long new requests wait for a background renewal */
+#define TOKEN_HOLD_MS 2000
+/* Try again this soon if a background renewal fails */
+#define TOKEN_RETRY_SECS 60
+/* Look at the wall clock at least this often while waiting to renew */
+#define TOKEN_CHECK_SECS (5 * 60)
+
+static gint64 token_refresh_due(ChimeConnectionPrivate *priv)
+{
+	return priv->token_time + priv->token_lifetime / 100 * TOKEN_REFRESH_PERCENT;
+}
+
+static void chime_renew_token(ChimeConnection *self, gboolean background);
+
+static gboolean token_refresh_timeout(gpointer _self)
 {
+	ChimeConnection *self = CHIME_CONNECTION(_self);
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
-	struct chime_msg *cmsg = NULL;
-	const gchar *sess_tok;
-	gchar *cookie_hdr;
 
-	if (!node || !parse_string(node, "SessionToken", &sess_tok)) {
-		chime_connection_fail(self, CHIME_ERROR_NETWORK,
-				      _("Failed to renew session token"));
-		chime_connection_set_session_token(self, NULL);
-		return;
+	priv->token_refresh_timer = 0;
+
+	/* Not yet due; the timer can't be trusted to have waited in real time */
+	if (priv->token_time && priv->token_lifetime &&
+	    g_get_real_time() < token_refresh_due(priv)) {
+		schedule_token_refresh(self);
+		return FALSE;
 	}
 
-	chime_connection_set_session_token(self, sess_tok);
+	if (priv->state != CHIME_STATE_DISCONNECTED && priv->profile_url &&
+	    !priv->token_renewing) {
+		chime_metric_inc(self, CHIME_METRIC_HTTP_REFRESHES);
+		chime_renew_token(self, TRUE);
+	}
+	return FALSE;
+}
 
-	if (priv->state == CHIME_STATE_DISCONNECTED)
+static void schedule_token_refresh(ChimeConnection *self)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
+	gint64 due, now = g_get_real_time();
+
+	if (priv->token_refresh_timer) {
+		g_source_remove(priv->token_refresh_timer);
+		priv->token_refresh_timer = 0;
+	}
+	if (!priv->token_time || !priv->token_lifetime)
+		return;
+
+	due = token_refresh_due(priv);
+	priv->token_refresh_timer = g_timeout_add_seconds(due > now ? MIN((due - now) / G_USEC_PER_SEC + 1,
+									  TOKEN_CHECK_SECS) : 0,
+							  token_refresh_timeout, self);
+}
+
+/* The token we've had since token_time has just been refused */
+static void learn_token_lifetime(ChimeConnection *self)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
+	gint64 age;
+
+	if (!priv->token_time)
 		return;
 
+	/* It may have expired a while before we used it, so a 401 sooner
+	 * than we expected is the better estimate, though not by more than
+	 * a factor of two at once. One later than expected comes after the
+	 * renewal was due, so it only means we missed that (asleep, or it
+	 * failed) and says nothing about how long tokens last. */
+	age = g_get_real_time() - priv->token_time;
+	if (age < TOKEN_MIN_LIFETIME)
+		return;
+
+	if (priv->token_lifetime) {
+		if (age >= priv->token_lifetime)
+			return;
+		age = MAX(age, priv->token_lifetime / 2);
+	}
+
+	priv->token_lifetime = known_token_lifetime = age;
+	chime_connection_log_cat(self, CHIME_LOG_HTTP, CHIME_LOGLVL_MISC,
+				 "Session tokens last about %" G_GINT64_FORMAT "s\n",
+				 age / G_USEC_PER_SEC);
+}
+
+/* Send the requests which were waiting for a token, with the current one */
+static void requeue_pending_auth(ChimeConnection *self)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
+	struct chime_msg *cmsg = NULL;
+	gchar *cookie_hdr;
+
 	cookie_hdr = g_strdup_printf("_aws_wt_session=%s", priv->session_token);
 
 	while ( (cmsg = g_queue_pop_head(priv->msgs_pending_auth)) ) {
 		soup_message_headers_replace(cmsg->msg->request_headers,
 					     "Cookie", cookie_hdr);
-		chime_connection_log(self, CHIME_LOGLVL_MISC, "Requeued %p to %s\n", cmsg->msg,
-				     soup_uri_get_path(soup_message_get_uri(cmsg->msg)));
+		chime_connection_log_cat(self, CHIME_LOG_HTTP, CHIME_LOGLVL_MISC,
+					 "Requeued %p to %s\n", cmsg->msg,
+					 soup_uri_get_path(soup_message_get_uri(cmsg->msg)));
+		g_queue_push_tail(priv->msgs_queued, cmsg);
 		g_object_ref(self);
+		chime_http_trace_start(cmsg);
 		soup_session_queue_message(priv->soup_sess, cmsg->msg,
 					   soup_msg_cb, cmsg);
 	}
@@ -717,38 +941,173 @@ static void renew_cb(ChimeConnection *self, SoupMessage *msg,
 	g_free(cookie_hdr);
 }
 
-static void chime_renew_token(ChimeConnection *self)
+/* A background renewal is taking a while; stop holding requests for it */
+static gboolean token_hold_timeout(gpointer _self)
+{
+	ChimeConnection *self = CHIME_CONNECTION(_self);
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
+
+	priv->token_hold_timer = 0;
+	priv->token_holding = FALSE;
+	requeue_pending_auth(self);
+	return FALSE;
+}
+
+/* If we get an auth failure on a standard request, we automatically attempt
+ * to renew the authentication token and resubmit the request. */
+static void renew_cb(ChimeConnection *self, SoupMessage *msg,
+		     JsonNode *node, gpointer _background)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
+	const gchar *sess_tok;
+
+	/* Still a background renewal, if nothing got a 401 meanwhile */
+	gboolean background = GPOINTER_TO_INT(_background) &&
+		!(priv->token_holding && !priv->token_hold_timer);
+
+	priv->token_renewing = FALSE;
+	priv->token_holding = FALSE;
+	if (priv->token_hold_timer) {
+		g_source_remove(priv->token_hold_timer);
+		priv->token_hold_timer = 0;
+	}
+
+	if (!node || !parse_string(node, "SessionToken", &sess_tok)) {
+		if (background && priv->state != CHIME_STATE_DISCONNECTED) {
+			/* The old one is still good for now */
+			chime_connection_log_cat(self, CHIME_LOG_HTTP, CHIME_LOGLVL_MISC,
+						 "Background token renewal failed (%d)\n",
+						 msg->status_code);
+			requeue_pending_auth(self);
+			if (!priv->token_refresh_timer)
+				priv->token_refresh_timer = g_timeout_add_seconds(TOKEN_RETRY_SECS,
+										  token_refresh_timeout,
+										  self);
+			return;
+		}
+		chime_connection_fail(self, CHIME_ERROR_NETWORK,
+				      _("Failed to renew session token"));
+		chime_connection_set_session_token(self, NULL);
+		return;
+	}
+
+	chime_connection_set_session_token(self, sess_tok);
+
+	if (priv->state == CHIME_STATE_DISCONNECTED)
+		return;
+
+	requeue_pending_auth(self);
+}
+
+static void chime_renew_token(ChimeConnection *self, gboolean background)
 {
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
 	SoupURI *uri;
-	JsonBuilder *builder;
-	JsonNode *node;
+	GString *body;
+
+	priv->token_renewing = TRUE;
+	priv->token_holding = TRUE;
+	if (background)
+		priv->token_hold_timer = g_timeout_add(TOKEN_HOLD_MS, token_hold_timeout, self);
 
-	builder = json_builder_new();
-	builder = json_builder_begin_object(builder);
-	builder = json_builder_set_member_name(builder, "Token");
-	builder = json_builder_add_string_value(builder, priv->session_token);
-	builder = json_builder_end_object(builder);
-	node = json_builder_get_root(builder);
+	body = chime_connection_json_buf(self);
+	chime_json_begin_object(body, NULL);
+	chime_json_add_string(body, "Token", priv->session_token);
+	chime_json_end_object(body);
 
 	uri = soup_uri_new_printf(priv->profile_url, "/tokens");
 	soup_uri_set_query_from_fields(uri, "Token", priv->session_token, NULL);
-	chime_connection_queue_http_request(self, node, uri, "POST", renew_cb, NULL);
+	chime_connection_queue_http_json(self, body, uri, "POST", renew_cb,
+					 GINT_TO_POINTER(background));
+}
 
-	json_node_unref(node);
-	g_object_unref(builder);
+/* Responses larger than this are parsed in a worker thread */
+#define ASYNC_PARSE_THRESHOLD (64 * 1024)
+
+static void dispatch_chime_msg(ChimeConnection *cxn, struct chime_msg *cmsg)
+{
+	chime_http_trace_finish(cxn, cmsg);
+
+	if (cmsg->cancelled) {
+		soup_message_set_status(cmsg->msg, SOUP_STATUS_CANCELLED);
+		cmsg->node = NULL;
+	}
+	if (cmsg->cb)
+		cmsg->cb(cxn, cmsg->msg, cmsg->node, cmsg->cb_data);
+	cmsg_free(cmsg);
+	g_object_unref(cxn);
+}
+
+/* Responses are handed to their callbacks in the order in which they
+ * arrived, even if an earlier one is still being parsed in a thread. */
+static void dispatch_parsed_msgs(ChimeConnection *cxn)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+	struct chime_msg *cmsg;
+
+	while ((cmsg = g_queue_peek_head(priv->msgs_parsing)) && cmsg->parsed) {
+		g_queue_pop_head(priv->msgs_parsing);
+		dispatch_chime_msg(cxn, cmsg);
+	}
+}
+
+/* May be called in a thread. Touches nothing but the cmsg. */
+static void parse_response(struct chime_msg *cmsg)
+{
+	SoupMessageBody *body = cmsg->msg->response_body;
+	GError *error = NULL;
+
+	cmsg->trace[CHIME_TRACE_EV_PARSE_START] = g_get_monotonic_time();
+	cmsg->parser = json_parser_new();
+	if (!json_parser_load_from_data(cmsg->parser, body->data, body->length, &error)) {
+		g_warning("Error loading data: %s", error->message);
+		g_error_free(error);
+	} else {
+		cmsg->node = json_parser_get_root(cmsg->parser);
+	}
+	cmsg->trace[CHIME_TRACE_EV_PARSE_DONE] = g_get_monotonic_time();
+}
+
+static void parse_thread(GTask *task, gpointer source, gpointer _cmsg,
+			 GCancellable *cancellable)
+{
+	parse_response(_cmsg);
+	g_task_return_boolean(task, TRUE);
+}
+
+static void parse_done(GObject *source, GAsyncResult *result, gpointer _cmsg)
+{
+	struct chime_msg *cmsg = _cmsg;
+	struct chime_scope scope;
+	/* Dispatching drops the last reference to the message */
+	gchar *path = g_strdup(soup_message_get_uri(cmsg->msg)->path);
+
+	chime_scope_enter(&scope, "http", path);
+	cmsg->parsed = TRUE;
+	dispatch_parsed_msgs(CHIME_CONNECTION(source));
+	chime_scope_exit(&scope);
+	g_free(path);
+}
+
+static void do_soup_msg_cb(SoupSession *soup_sess, SoupMessage *msg, gpointer _cmsg);
+
+static void soup_msg_cb(SoupSession *soup_sess, SoupMessage *msg, gpointer _cmsg)
+{
+	struct chime_scope scope;
+
+	chime_scope_enter(&scope, "http", soup_message_get_uri(msg)->path);
+	do_soup_msg_cb(soup_sess, msg, _cmsg);
+	chime_scope_exit(&scope);
 }
 
 /* First callback for SoupMessage completion — do the common
  * parsing of the JSON response (if any) and hand it on to the
  * real callback function. Also handles auth token renewal. */
-static void soup_msg_cb(SoupSession *soup_sess, SoupMessage *msg, gpointer _cmsg)
+static void do_soup_msg_cb(SoupSession *soup_sess, SoupMessage *msg, gpointer _cmsg)
 {
 	struct chime_msg *cmsg = _cmsg;
 	ChimeConnection *cxn = cmsg->cxn;
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
-	JsonParser *parser = NULL;
-	JsonNode *node = NULL;
 
 	if (priv->msgs_queued)
 		g_queue_remove(priv->msgs_queued, cmsg);
@@ -759,58 +1118,66 @@ static void soup_msg_cb(SoupSession *soup_sess, SoupMessage *msg, gpointer _cmsg
 	    (msg->status_code == 401 /*||
 	     (msg->status_code == 7 && !g_queue_is_empty(priv->msgs_pending_auth))*/)) {
 		g_object_ref(msg);
-		gboolean already_renewing = !g_queue_is_empty(priv->msgs_pending_auth);
 		g_queue_push_tail(priv->msgs_pending_auth, cmsg);
-		if (!already_renewing) {
-#if 0 /* Not working; we can catch statue_code==7 above but it's also breaking
-	 the websocket connection too. */
-			while (!g_queue_is_empty(priv->msgs_queued)) {
-				cmsg = g_queue_pop_head(priv->msgs_queued);
-				soup_session_cancel_message(priv->soup_sess, cmsg->msg, 401);
-				// They should requeue themselves
+		if (!priv->token_renewing) {
+			chime_metric_inc(cxn, CHIME_METRIC_HTTP_RENEWALS);
+			learn_token_lifetime(cxn);
+			chime_renew_token(cxn, FALSE);
+		} else {
+			/* Too late for the background renewal; hold everything for it */
+			if (priv->token_hold_timer) {
+				g_source_remove(priv->token_hold_timer);
+				priv->token_hold_timer = 0;
 			}
-#endif
-			chime_renew_token(cxn);
+			priv->token_holding = TRUE;
 		}
 		g_object_unref(cxn);
 		return;
 	}
 
+	chime_metric_inc(cxn, CHIME_METRIC_HTTP_REQUESTS);
+	if (!SOUP_STATUS_IS_SUCCESSFUL(msg->status_code))
+		chime_metric_inc(cxn, CHIME_METRIC_HTTP_ERRORS);
+	chime_metric_observe(cxn, CHIME_METRIC_HTTP_DURATION,
+			     g_get_monotonic_time() - cmsg->queued_time);
+
+	/* Keep it until the callback has been run; libsoup drops its
+	 * reference as soon as we return. */
+	g_object_ref(msg);
+
 	const gchar *content_type = soup_message_headers_get_content_type(msg->response_headers, NULL);
 	if (!g_strcmp0(content_type, "application/json") && msg->response_body->data) {
-		GError *error = NULL;
+		if (msg->response_body->length >= ASYNC_PARSE_THRESHOLD) {
+			g_queue_push_tail(priv->msgs_parsing, cmsg);
 
-		parser = json_parser_new();
-		if (!json_parser_load_from_data(parser, msg->response_body->data, msg->response_body->length, &error)) {
-			g_warning("Error loading data: %s", error->message);
-			g_error_free(error);
-		} else {
-			node = json_parser_get_root(parser);
+			GTask *task = g_task_new(cxn, NULL, parse_done, cmsg);
+			g_task_set_task_data(task, cmsg, NULL);
+			g_task_run_in_thread(task, parse_thread);
+			g_object_unref(task);
+			return;
 		}
+		parse_response(cmsg);
 	}
+	cmsg->parsed = TRUE;
 
-	if (cmsg->cb)
-		cmsg->cb(cmsg->cxn, msg, node, cmsg->cb_data);
-	g_clear_object(&parser);
-	g_free(cmsg);
-	g_object_unref(cxn);
+	if (g_queue_is_empty(priv->msgs_parsing))
+		dispatch_chime_msg(cxn, cmsg);
+	else
+		g_queue_push_tail(priv->msgs_parsing, cmsg);
 }
 
-SoupMessage *
-chime_connection_queue_http_request(ChimeConnection *self, JsonNode *node,
-				    SoupURI *uri, const gchar *method,
-				    ChimeSoupMessageCallback callback,
-				    gpointer cb_data)
+static struct chime_msg *
+new_chime_msg(ChimeConnection *self, SoupURI *uri, const gchar *method,
+	      ChimeSoupMessageCallback callback, gpointer cb_data)
 {
-	g_return_val_if_fail(CHIME_IS_CONNECTION(self), NULL);
-	g_return_val_if_fail(SOUP_URI_IS_VALID(uri), NULL);
-
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
 	struct chime_msg *cmsg = g_new0(struct chime_msg, 1);
+	chime_mem_account(CHIME_MEM_HTTP_MSG, sizeof(*cmsg), 1);
 
 	cmsg->cxn = self;
 	cmsg->cb = callback;
 	cmsg->cb_data = cb_data;
+	cmsg->queued_time = g_get_monotonic_time();
 	cmsg->msg = soup_message_new_from_uri(method, uri);
 	soup_uri_free(uri);
 
@@ -822,6 +1189,41 @@ chime_connection_queue_http_request(ChimeConnection *self, JsonNode *node,
 
 	soup_message_headers_append(cmsg->msg->request_headers, "Accept", "*/*");
 	soup_message_headers_append(cmsg->msg->request_headers, "User-Agent", "Pidgin-Chime " PACKAGE_VERSION);
+
+	return cmsg;
+}
+
+static SoupMessage *
+queue_chime_msg(ChimeConnection *self, struct chime_msg *cmsg)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
+
+	/* If we are already renewing the token, don't bother submitting it with the
+	 * old token just for it to fail (and perhaps trigger *another* token reneawl
+	 * which isn't even needed. */
+	if (cmsg->cb != renew_cb && priv->token_holding)
+		g_queue_push_tail(priv->msgs_pending_auth, cmsg);
+	else {
+		g_queue_push_tail(priv->msgs_queued, cmsg);
+		g_object_ref(self);
+		chime_http_trace_start(cmsg);
+		soup_session_queue_message(priv->soup_sess, cmsg->msg, soup_msg_cb, cmsg);
+	}
+
+	return cmsg->msg;
+}
+
+SoupMessage *
+chime_connection_queue_http_request(ChimeConnection *self, JsonNode *node,
+				    SoupURI *uri, const gchar *method,
+				    ChimeSoupMessageCallback callback,
+				    gpointer cb_data)
+{
+	g_return_val_if_fail(CHIME_IS_CONNECTION(self), NULL);
+	g_return_val_if_fail(SOUP_URI_IS_VALID(uri), NULL);
+
+	struct chime_msg *cmsg = new_chime_msg(self, uri, method, callback, cb_data);
+
 	if (node) {
 		gchar *body;
 		gsize body_size;
@@ -834,18 +1236,26 @@ chime_connection_queue_http_request(ChimeConnection *self, JsonNode *node,
 		g_object_unref(gen);
 	}
 
-	/* If we are already renewing the token, don't bother submitting it with the
-	 * old token just for it to fail (and perhaps trigger *another* token reneawl
-	 * which isn't even needed. */
-	if (cmsg->cb != renew_cb && !g_queue_is_empty(priv->msgs_pending_auth))
-		g_queue_push_tail(priv->msgs_pending_auth, cmsg);
-	else {
-		g_queue_push_tail(priv->msgs_queued, cmsg);
-		g_object_ref(self);
-		soup_session_queue_message(priv->soup_sess, cmsg->msg, soup_msg_cb, cmsg);
-	}
+	return queue_chime_msg(self, cmsg);
+}
 
-	return cmsg->msg;
+/* For bodies built with the chime_json_* writer. The buffer is copied so
+ * that the caller can reuse it straight away. */
+SoupMessage *
+chime_connection_queue_http_json(ChimeConnection *self, GString *body,
+				 SoupURI *uri, const gchar *method,
+				 ChimeSoupMessageCallback callback,
+				 gpointer cb_data)
+{
+	g_return_val_if_fail(CHIME_IS_CONNECTION(self), NULL);
+	g_return_val_if_fail(SOUP_URI_IS_VALID(uri), NULL);
+
+	struct chime_msg *cmsg = new_chime_msg(self, uri, method, callback, cb_data);
+
+	soup_message_set_request(cmsg->msg, "application/json", SOUP_MEMORY_COPY,
+				 body->str, body->len);
+
+	return queue_chime_msg(self, cmsg);
 }
 
 void chime_connection_new_contact(ChimeConnection *cxn, ChimeContact *contact)
@@ -868,16 +1278,10 @@ void chime_connection_new_meeting(ChimeConnection *cxn, ChimeMeeting *meeting)
 	g_signal_emit(cxn, signals[NEW_MEETING], 0, meeting);
 }
 
-void chime_connection_log(ChimeConnection *cxn, ChimeLogLevel level, const gchar *format, ...)
+/* Called from chime_connection_do_log() once the level has been checked */
+void chime_connection_emit_log(ChimeConnection *cxn, ChimeLogLevel level, const gchar *str)
 {
-	va_list args;
-	gchar *str;
-
-	va_start(args, format);
-	str = g_strdup_vprintf(format, args);
-	va_end(args);
 	g_signal_emit(cxn, signals[LOG_MESSAGE], 0, level, str);
-	g_free(str);
 }
 
 void chime_connection_progress(ChimeConnection *cxn, int percent, const gchar *message)
@@ -983,7 +1387,7 @@ gboolean parse_string(JsonNode *parent, const gchar *name, const gchar **res)
 		return FALSE;
 
 	*res = str;
-	chime_debug("Got %s = %s\n", name, str);
+	chime_debug_cat(CHIME_LOG_SYNC, "Got %s = %s\n", name, str);
 	return TRUE;
 }
 
@@ -1111,6 +1515,15 @@ const gchar *chime_connection_get_email(ChimeConnection *self)
 	return priv->email;
 }
 
+gint64 chime_connection_get_online_time(ChimeConnection *self, ChimeOnlineComponent component)
+{
+	g_return_val_if_fail(CHIME_IS_CONNECTION(self), -1);
+	g_return_val_if_fail(component < CHIME_ONLINE_LAST, -1);
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
+
+	return priv->online_time[component];
+}
+
 struct fetch_msg_data {
 	ChimeObject *obj;
 	GHashTable *query;
@@ -1215,19 +1628,33 @@ chime_connection_fetch_messages_finish(ChimeConnection *self, GAsyncResult *resu
 
 
 
+struct last_read_data {
+	ChimeObject *obj;
+	gchar *msg_id;
+};
+static void free_last_read_data(gpointer _lrd)
+{
+	struct last_read_data *lrd = _lrd;
+	g_object_unref(lrd->obj);
+	g_free(lrd->msg_id);
+	g_free(lrd);
+}
+
 static void update_last_read_cb(ChimeConnection *self, SoupMessage *msg,
 				JsonNode *node, gpointer user_data)
 {
 	GTask *task = G_TASK(user_data);
+	struct last_read_data *lrd = g_task_get_task_data(task);
 
-	/* Nothing to do o nsuccess */
 	if (!SOUP_STATUS_IS_SUCCESSFUL(msg->status_code)) {
 		g_task_return_new_error(task, CHIME_ERROR,
 					CHIME_ERROR_NETWORK,
 					_("Failed to set LastReadMessageID: %d %s"),
 					msg->status_code, msg->reason_phrase);
-	} else
+	} else {
+		chime_activity_mark_read(self, lrd->obj, lrd->msg_id);
 		g_task_return_boolean(task, TRUE);
+	}
 
 	g_object_unref(task);
 }
@@ -1244,21 +1671,21 @@ void chime_connection_update_last_read_async (ChimeConnection    *self,
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (self);
 
 	GTask *task = g_task_new(self, cancellable, callback, user_data);
+	struct last_read_data *lrd = g_new0(struct last_read_data, 1);
+	lrd->obj = g_object_ref(obj);
+	lrd->msg_id = g_strdup(msg_id);
+	g_task_set_task_data(task, lrd, free_last_read_data);
 
-	JsonBuilder *jb = json_builder_new();
-	jb = json_builder_begin_object(jb);
-	jb = json_builder_set_member_name(jb, "LastReadMessageId");
-	jb = json_builder_add_string_value(jb, msg_id);
-	jb = json_builder_end_object(jb);
+	GString *body = chime_connection_json_buf(self);
+	chime_json_begin_object(body, NULL);
+	chime_json_add_string(body, "LastReadMessageId", msg_id);
+	chime_json_end_object(body);
 
 	SoupURI *uri = soup_uri_new_printf(priv->messaging_url,
 					   "/%ss/%s",
 					   CHIME_IS_ROOM(obj) ? "room" : "conversation",
 					   chime_object_get_id(obj));
-	JsonNode *node = json_builder_get_root(jb);
-	chime_connection_queue_http_request(self, node, uri, "POST", update_last_read_cb, task);
-	json_node_unref(node);
-	g_object_unref(jb);
+	chime_connection_queue_http_json(self, body, uri, "POST", update_last_read_cb, task);
 }
 
 gboolean chime_connection_update_last_read_finish (ChimeConnection  *self,
@@ -50,11 +50,43 @@ typedef enum {
 	CHIME_LOGLVL_FATAL
 } ChimeLogLevel;
 
+/* Messages below this level aren't even formatted, let alone emitted
+ * by the "log-message" signal. It is shared by all connections. */
+void chime_log_set_level(ChimeLogLevel level);
+
+typedef void (*ChimeLogRingFunc)(gint64 time, ChimeLogLevel level,
+				 const gchar *category, const gchar *message,
+				 gpointer user_data);
+void chime_log_ring_foreach(ChimeLogRingFunc fn, gpointer user_data);
+
+typedef enum {
+	CHIME_MEM_CONTACT,
+	CHIME_MEM_ROOM,
+	CHIME_MEM_ROOM_MEMBER,
+	CHIME_MEM_CONVERSATION,
+	CHIME_MEM_MEETING,
+	CHIME_MEM_CALL,
+	CHIME_MEM_CALL_PARTICIPANT,
+	CHIME_MEM_HTTP_MSG,
+	CHIME_MEM_AUDIO_REASSEMBLY,
+	CHIME_MEM_WEBSOCKET_QUEUE,
+	CHIME_MEM_MSG_GATHER,
+	CHIME_MEM_LAST
+} ChimeMemTag;
+
+/* A no-op unless CHIME_DEBUG includes "memory" */
+void chime_mem_account(ChimeMemTag tag, gssize bytes, gint objects);
+gchar *chime_mem_report(void);
+gboolean chime_mem_get_live(ChimeMemTag tag, const gchar **name,
+			    gssize *objects, gssize *bytes);
+
 typedef void (*ChimeSoupMessageCallback)(ChimeConnection *cxn,
 					 SoupMessage *msg,
 					 JsonNode *node,
 					 gpointer cb_data);
 
+void chime_set_shared_sessions(gboolean share);
+
 ChimeConnection *chime_connection_new                        (const gchar *email,
 							      const gchar *server,
 							      const gchar *device_token,
@@ -99,7 +131,26 @@ gboolean chime_connection_log_out_finish (ChimeConnection  *self,
 					  GAsyncResult     *result,
 					  GError          **error);
 
+typedef enum {
+	CHIME_ONLINE_JUGG,
+	CHIME_ONLINE_CONTACTS,
+	CHIME_ONLINE_ROOMS,
+	CHIME_ONLINE_CONVERSATIONS,
+	CHIME_ONLINE_MEETINGS,
+	CHIME_ONLINE_LAST
+} ChimeOnlineComponent;
+
+/* Microseconds from chime_connection_connect() until the component was
+ * first ready, or -1 if it isn't yet. */
+gint64 chime_connection_get_online_time(ChimeConnection *cxn, ChimeOnlineComponent component);
+
+gchar *chime_connection_get_metrics(ChimeConnection *cxn);
+gboolean chime_connection_serve_metrics(ChimeConnection *cxn, const gchar *path,
+					GError **error);
+
 const gchar *chime_connection_get_profile_id(ChimeConnection *self);
+gboolean chime_connection_is_mentioned(ChimeConnection *cxn, const gchar *content);
+void chime_connection_set_mention_keywords(ChimeConnection *cxn, const gchar *keywords);
 const gchar *chime_connection_get_display_name(ChimeConnection *self);
 const gchar *chime_connection_get_email(ChimeConnection *self);
 void chime_connection_connect(ChimeConnection *cxn);
@@ -41,10 +41,11 @@ struct _ChimeContact {
 	gboolean subscribed;
 	ChimeConnection *cxn; /* For unsubscribing from jugg channels */
 
-	gchar *presence_channel;
-	gchar *profile_channel;
-	gchar *full_name;
-	gchar *display_name;
+	/* All interned, as they're common to every account in the process */
+	const gchar *presence_channel;
+	const gchar *profile_channel;
+	const gchar *full_name;
+	const gchar *display_name;
 
 	ChimeAvailability availability;
 	gint64 avail_revision;
@@ -91,10 +92,12 @@ chime_contact_finalize(GObject *object)
 {
 	ChimeContact *self = CHIME_CONTACT(object);
 
-	g_free(self->presence_channel);
-	g_free(self->profile_channel);
-	g_free(self->full_name);
-	g_free(self->display_name);
+	chime_unintern(self->presence_channel);
+	chime_unintern(self->profile_channel);
+	chime_unintern(self->full_name);
+	chime_unintern(self->display_name);
+
+	chime_mem_account(CHIME_MEM_CONTACT, -(gssize)sizeof(*self), -1);
 
 	G_OBJECT_CLASS(chime_contact_parent_class)->finalize(object);
 }
@@ -138,20 +141,16 @@ static void chime_contact_set_property(GObject *object, guint prop_id,
 
 	switch (prop_id) {
 	case PROP_PROFILE_CHANNEL:
-		g_free(self->profile_channel);
-		self->profile_channel = g_value_dup_string(value);
+		chime_intern_replace(&self->profile_channel, g_value_get_string(value));
 		break;
 	case PROP_PRESENCE_CHANNEL:
-		g_free(self->presence_channel);
-		self->presence_channel = g_value_dup_string(value);
+		chime_intern_replace(&self->presence_channel, g_value_get_string(value));
 		break;
 	case PROP_FULL_NAME:
-		g_free(self->full_name);
-		self->full_name = g_value_dup_string(value);
+		chime_intern_replace(&self->full_name, g_value_get_string(value));
 		break;
 	case PROP_DISPLAY_NAME:
-		g_free(self->display_name);
-		self->display_name = g_value_dup_string(value);
+		chime_intern_replace(&self->display_name, g_value_get_string(value));
 		break;
 	case PROP_AVAILABILITY:
 		self->availability = g_value_get_int(value);
@@ -222,6 +221,7 @@ static void chime_contact_class_init(ChimeContactClass *klass)
 
 static void chime_contact_init(ChimeContact *self)
 {
+	chime_mem_account(CHIME_MEM_CONTACT, sizeof(*self), 1);
 }
 
 const gchar *chime_contact_get_profile_id(ChimeContact *contact)
@@ -321,32 +321,30 @@ static ChimeContact *find_or_create_contact(ChimeConnection *cxn, const gchar *i
 		return contact;
 	}
 
+	g_object_freeze_notify(G_OBJECT(contact));
+
 	/* This should never happen? */
 	if (email && g_strcmp0(email, chime_object_get_name(CHIME_OBJECT(contact)))) {
 		chime_object_rename(CHIME_OBJECT(contact), email);
 	}
-	if (full_name && g_strcmp0(full_name, contact->full_name)) {
-		g_free(contact->full_name);
-		contact->full_name = g_strdup(full_name);
-		g_object_notify(G_OBJECT(contact), "full-name");
-	}
-	if (display_name && g_strcmp0(display_name, contact->display_name)) {
-		g_free(contact->display_name);
-		contact->display_name = g_strdup(display_name);
-		g_object_notify(G_OBJECT(contact), "display-name");
-	}
+	if (full_name && chime_intern_replace(&contact->full_name, full_name))
+		g_object_notify_by_pspec(G_OBJECT(contact), props[PROP_FULL_NAME]);
+	if (display_name && chime_intern_replace(&contact->display_name, display_name))
+		g_object_notify_by_pspec(G_OBJECT(contact), props[PROP_DISPLAY_NAME]);
 
 	if (presence_channel && !contact->presence_channel) {
-		contact->presence_channel = g_strdup(presence_channel);
-		g_object_notify(G_OBJECT(contact), "presence-channel");
+		contact->presence_channel = chime_intern(presence_channel);
+		g_object_notify_by_pspec(G_OBJECT(contact), props[PROP_PRESENCE_CHANNEL]);
 		if (contact->subscribed)
 			subscribe_contact(cxn, contact);
 	}
 	if (profile_channel && !contact->profile_channel) {
-		contact->profile_channel = g_strdup(profile_channel);
-		g_object_notify(G_OBJECT(contact), "profile-channel");
+		contact->profile_channel = chime_intern(profile_channel);
+		g_object_notify_by_pspec(G_OBJECT(contact), props[PROP_PROFILE_CHANNEL]);
 	}
 
+	g_object_thaw_notify(G_OBJECT(contact));
+
 	if (is_contact)
 		chime_object_collection_hash_object(&priv->contacts,
 						    CHIME_OBJECT(contact), TRUE);
@@ -449,7 +447,7 @@ static gboolean set_contact_presence(ChimeConnection *cxn, JsonNode *node,
 	contact->avail_revision = revision;
 	if (contact->availability != availability) {
 		contact->availability = availability;
-		g_object_notify(G_OBJECT(contact), "availability");
+		g_object_notify_by_pspec(G_OBJECT(contact), props[PROP_AVAILABILITY]);
 	}
 
 	return TRUE;
@@ -546,6 +544,8 @@ static void contacts_cb(ChimeConnection *cxn, SoupMessage *msg, JsonNode *node,
 			fetch_contacts(cxn, next_token);
 		else {
 			priv->contacts_sync = CHIME_SYNC_IDLE;
+			chime_metric_observe(cxn, CHIME_METRIC_SYNC_CONTACTS,
+					     g_get_monotonic_time() - priv->contacts_sync_start);
 
 			chime_object_collection_expire_outdated(&priv->contacts);
 
@@ -582,6 +582,7 @@ static void fetch_contacts(ChimeConnection *cxn, const gchar *next_token)
 		case CHIME_SYNC_IDLE:
 			priv->contacts.generation++;
 			priv->contacts_sync = CHIME_SYNC_FETCHING;
+			priv->contacts_sync_start = g_get_monotonic_time();
 		}
 	}
 
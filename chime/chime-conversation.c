@@ -65,12 +65,23 @@ struct _ChimeConversation {
 
 	GHashTable *members; /* Not including ourself */
 
+	/* Profile ID → strv of the member_fields[] last parsed for that member */
+	GHashTable *member_fields;
+
 	gboolean visibility;
 
 	CHIME_PROPS_VARS;
 
 	ChimeNotifyPref mobile_notification;
 	ChimeNotifyPref desktop_notification;
+
+	/* Outbound typing state; see chime_conversation_send_typing() */
+	gboolean typing_sent;
+	gint64 typing_sent_time;
+	guint typing_timer;
+
+	/* Profile IDs of members we have reported as typing */
+	GHashTable *typing_peers;
 };
 
 G_DEFINE_TYPE(ChimeConversation, chime_conversation, CHIME_TYPE_OBJECT)
@@ -83,6 +94,12 @@ chime_conversation_dispose(GObject *object)
 	ChimeConversation *self = CHIME_CONVERSATION(object);
 
 	unsubscribe_conversation(NULL, self, NULL);
+	if (self->typing_timer) {
+		g_source_remove(self->typing_timer);
+		self->typing_timer = 0;
+	}
+	g_clear_pointer(&self->typing_peers, g_hash_table_destroy);
+	g_clear_pointer(&self->member_fields, g_hash_table_destroy);
 	if (self->members) {
 		g_hash_table_destroy(self->members);
 		self->members = NULL;
@@ -99,6 +116,8 @@ chime_conversation_finalize(GObject *object)
 
 	CHIME_PROPS_FREE
 
+	chime_mem_account(CHIME_MEM_CONVERSATION, -(gssize)sizeof(*self), -1);
+
 	G_OBJECT_CLASS(chime_conversation_parent_class)->finalize(object);
 }
 
@@ -215,8 +234,14 @@ static void unref_member(gpointer obj)
 }
 static void chime_conversation_init(ChimeConversation *self)
 {
+	chime_mem_account(CHIME_MEM_CONVERSATION, sizeof(*self), 1);
+
 	self->members = g_hash_table_new_full(g_str_hash, g_str_equal,
 					      NULL, unref_member);
+	self->typing_peers = g_hash_table_new_full(g_str_hash, g_str_equal,
+						   g_free, NULL);
+	self->member_fields = g_hash_table_new_full(g_str_hash, g_str_equal,
+						    g_free, (GDestroyNotify)g_strfreev);
 }
 
 const gchar *chime_conversation_get_id(ChimeConversation *self)
@@ -299,6 +324,15 @@ static gboolean conv_typing_jugg_cb(ChimeConnection *cxn, gpointer _conv, JsonNo
 	if (!contact)
 		return FALSE;
 
+	/* Clients refresh their typing state periodically; only tell the UI
+	 * when it actually changes. */
+	if (state) {
+		if (g_hash_table_contains(conv->typing_peers, from))
+			return TRUE;
+		g_hash_table_add(conv->typing_peers, g_strdup(from));
+	} else if (!g_hash_table_remove(conv->typing_peers, from))
+		return TRUE;
+
 	g_signal_emit(conv, signals[TYPING], 0, contact, state);
 	return TRUE;
 }
@@ -323,6 +357,8 @@ static gboolean conv_membership_jugg_cb(ChimeConnection *cxn, gpointer _conv, Js
 	if (member) {
 		const gchar *id = chime_contact_get_profile_id(member);
 		g_hash_table_insert(conv->members, (gpointer)id, member);
+		/* Make the next full member list parse this one again */
+		g_hash_table_remove(conv->member_fields, id);
 		return TRUE;
 	}
 	return FALSE;
@@ -339,38 +375,98 @@ subscribe_conversation(ChimeConnection *cxn, ChimeConversation *conv)
 			     conv_typing_jugg_cb, conv);
 }
 
-static void parse_members(ChimeConnection *cxn, ChimeConversation *conv, JsonNode *node)
+/* The fields of a Members entry which parse_conversation_contact() uses */
+static const gchar *member_fields[] = { "Email", "FullName", "PresenceChannel", "DisplayName" };
+
+static gboolean member_fields_equal(JsonNode *node, gchar **old)
+{
+	const gchar *str;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(member_fields); i++) {
+		if (!parse_string(node, member_fields[i], &str))
+			str = "";
+		if (g_strcmp0(str, old[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static gchar **member_fields_dup(JsonNode *node)
+{
+	gchar **fields = g_new0(gchar *, G_N_ELEMENTS(member_fields) + 1);
+	const gchar *str;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(member_fields); i++) {
+		if (!parse_string(node, member_fields[i], &str))
+			str = "";
+		fields[i] = g_strdup(str);
+	}
+	return fields;
+}
+
+/*
+ * Conversations are sent in full whenever anything changes, including
+ * just LastSent when a message arrives, so large group conversations
+ * would have every member looked up and rehashed each time. Instead we
+ * keep the fields we last parsed for each member and only parse the
+ * entries which are new or differ from those.
+ *
+ * Members missing from the list are not removed, as before; there is no
+ * membership signal to tell the client that someone has left.
+ *
+ * Returns TRUE if any member was added or had its details changed.
+ */
+static gboolean parse_members(ChimeConnection *cxn, ChimeConversation *conv, JsonNode *node)
 {
 	JsonArray *arr = json_node_get_array(node);
-	int i, len = json_array_get_length(arr);
+	guint i, len = json_array_get_length(arr);
+	gboolean changed = FALSE;
 
 	for (i = 0; i < len; i++) {
-		ChimeContact *member = chime_connection_parse_conversation_contact(cxn,
-										   json_array_get_element(arr, i), NULL);
+		JsonNode *member_node = json_array_get_element(arr, i);
+		const gchar *profile_id;
+		gchar **old;
+
+		if (!parse_string(member_node, "ProfileId", &profile_id))
+			continue;
+
+		old = g_hash_table_lookup(conv->member_fields, profile_id);
+		if (old && member_fields_equal(member_node, old) &&
+		    g_hash_table_contains(conv->members, profile_id))
+			continue;
+
+		ChimeContact *member = chime_connection_parse_conversation_contact(cxn, member_node, NULL);
 		if (member) {
 			const gchar *id = chime_contact_get_profile_id(member);
 			g_hash_table_insert(conv->members, (gpointer)id, member);
+			g_hash_table_insert(conv->member_fields, g_strdup(id),
+					    member_fields_dup(member_node));
+			changed = TRUE;
 		}
 	}
+
+	return changed;
 }
 
 static void generate_conv_name(ChimeConnection *cxn, ChimeConversation *conv)
 {
-	GList *m = g_hash_table_get_values(conv->members);
-	GPtrArray *names = g_ptr_array_new();
-
-	while (m) {
-		ChimeContact *contact = m->data;
-		if (strcmp(chime_contact_get_profile_id(contact), chime_connection_get_profile_id(cxn)))
+	const gchar *self_id = chime_connection_get_profile_id(cxn);
+	GPtrArray *names = g_ptr_array_sized_new(g_hash_table_size(conv->members) + 1);
+	GHashTableIter iter;
+	gpointer id, contact;
+
+	g_hash_table_iter_init(&iter, conv->members);
+	while (g_hash_table_iter_next(&iter, &id, &contact)) {
+		if (strcmp(id, self_id))
 			g_ptr_array_add(names, (gchar *)chime_contact_get_display_name(contact));
-		m = g_list_remove(m, contact);
 	}
 	g_ptr_array_add(names, NULL);
 	gchar *name = g_strjoinv("; ", (gchar **)names->pdata);
 	g_ptr_array_unref(names);
 
 	chime_object_rename(CHIME_OBJECT(conv), name);
-	/* No need to notify since nobody's seen it yet anyway. */
 	g_free(name);
 }
 
@@ -379,7 +475,7 @@ static ChimeConversation *chime_connection_parse_conversation(ChimeConnection *c
 						       GError **error)
 {
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE(cxn);
-	const gchar *id, *name;
+	const gchar *id, *name, *last_read = NULL;
 	gboolean visibility;
 	ChimeNotifyPref desktop, mobile;
 	JsonNode *members_node;
@@ -395,6 +491,8 @@ static ChimeConversation *chime_connection_parse_conversation(ChimeConnection *c
 			    _("Failed to parse Conversation node"));
 		return NULL;
 	}
+	/* Not a property, but the unread tracking will use it if present */
+	parse_string(node, "LastRead", &last_read);
 
 	JsonObject *obj = json_node_get_object(node);
 	node = json_object_get_member(obj, "Preferences");
@@ -427,34 +525,43 @@ static ChimeConversation *chime_connection_parse_conversation(ChimeConnection *c
 		if (!name || !name[0])
 			generate_conv_name(cxn, conversation);
 
+		chime_activity_update(cxn, CHIME_OBJECT(conversation),
+				      conversation->last_sent, last_read, NULL);
+
 		/* Emit signal on ChimeConnection to admit existence of new conversation */
 		chime_connection_new_conversation(cxn, conversation);
 
 		return conversation;
 	}
 
-	if (name && name[0] && g_strcmp0(name, chime_object_get_name(CHIME_OBJECT(conversation)))) {
+	/* Emit the notifications together, once the conversation is consistent */
+	g_object_freeze_notify(G_OBJECT(conversation));
+
+	if (name && name[0] && g_strcmp0(name, chime_object_get_name(CHIME_OBJECT(conversation))))
 		chime_object_rename(CHIME_OBJECT(conversation), name);
-		g_object_notify(G_OBJECT(conversation), "name");
-	}
 	if (visibility != conversation->visibility) {
 		conversation->visibility = visibility;
-		g_object_notify(G_OBJECT(conversation), "visibility");
+		g_object_notify_by_pspec(G_OBJECT(conversation), props[PROP_VISIBILITY]);
 	}
 
 	CHIME_PROPS_UPDATE
 
 	if (desktop != conversation->desktop_notification) {
 		conversation->desktop_notification = desktop;
-		g_object_notify(G_OBJECT(conversation), "desktop-notification-prefs");
+		g_object_notify_by_pspec(G_OBJECT(conversation), props[PROP_DESKTOP_NOTIFICATION_PREFS]);
 	}
 	if (mobile != conversation->mobile_notification) {
 		conversation->mobile_notification = mobile;
-		g_object_notify(G_OBJECT(conversation), "mobile-notification-prefs");
+		g_object_notify_by_pspec(G_OBJECT(conversation), props[PROP_MOBILE_NOTIFICATION_PREFS]);
 	}
 
+	g_object_thaw_notify(G_OBJECT(conversation));
+
 	chime_object_collection_hash_object(&priv->conversations, CHIME_OBJECT(conversation), TRUE);
-	parse_members(cxn, conversation, members_node);
+	if (parse_members(cxn, conversation, members_node) && (!name || !name[0]))
+		generate_conv_name(cxn, conversation);
+	chime_activity_update(cxn, CHIME_OBJECT(conversation),
+			      conversation->last_sent, last_read, NULL);
 
 	return conversation;
 }
@@ -495,6 +602,8 @@ static void conversations_cb(ChimeConnection *cxn, SoupMessage *msg, JsonNode *n
 			fetch_conversations(cxn, next_token);
 		else {
 			priv->conversations_sync = CHIME_SYNC_IDLE;
+			chime_metric_observe(cxn, CHIME_METRIC_SYNC_CONVERSATIONS,
+					     g_get_monotonic_time() - priv->conversations_sync_start);
 
 			chime_object_collection_expire_outdated(&priv->conversations);
 
@@ -531,6 +640,7 @@ static void fetch_conversations(ChimeConnection *cxn, const gchar *next_token)
 		case CHIME_SYNC_IDLE:
 			priv->conversations.generation++;
 			priv->conversations_sync = CHIME_SYNC_FETCHING;
+			priv->conversations_sync_start = g_get_monotonic_time();
 		}
 	}
 
@@ -618,6 +728,14 @@ static gboolean conv_msg_jugg_cb(ChimeConnection *cxn, gpointer _unused, JsonNod
 	if (!parse_string(record, "MessageId", &id))
 		return FALSE;
 
+	/* Sending a message implicitly ends the sender's typing state, so
+	 * don't suppress the next indication from them. */
+	const gchar *sender;
+	if (parse_string(record, "Sender", &sender))
+		g_hash_table_remove(conv->typing_peers, sender);
+
+	chime_activity_message(cxn, CHIME_OBJECT(conv), record, FALSE);
+
 	g_signal_emit(conv, signals[MESSAGE], 0, record);
 	return TRUE;
 }
@@ -706,36 +824,72 @@ void chime_connection_foreach_conversation(ChimeConnection *cxn, ChimeConversati
 	chime_object_collection_foreach_object(cxn, &priv->conversations, (ChimeObjectCB)cb, cbdata);
 }
 
+static void publish_typing(ChimeConnection *cxn, ChimeConversation *conv,
+			   gboolean typing)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+	GString *body = chime_connection_json_buf(cxn);
+
+	chime_json_begin_object(body, NULL);
+	chime_json_add_string(body, "channel", conv->channel);
+	chime_json_begin_object(body, "data");
+	chime_json_add_string(body, "klass", "TypingIndicator");
+	chime_json_add_boolean(body, "state", typing);
+	chime_json_end_object(body);
+	chime_json_begin_array(body, "except");
+	chime_json_add_string(body, NULL, priv->ws_key);
+	chime_json_end_array(body);
+	chime_json_add_string(body, "type", "publish");
+	chime_json_end_object(body);
+
+	if (chime_connection_jugg_send_json(cxn, body)) {
+		conv->typing_sent = typing;
+		conv->typing_sent_time = g_get_monotonic_time();
+	}
+}
+
+static gboolean typing_expired(gpointer _conv)
+{
+	ChimeConversation *conv = CHIME_CONVERSATION(_conv);
+
+	conv->typing_timer = 0;
+	if (conv->cxn && conv->typing_sent)
+		publish_typing(conv->cxn, conv, FALSE);
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * The UI may call this on every keystroke. We publish "typing" when it
+ * starts and then at most once per CHIME_TYPING_INTERVAL while it
+ * continues, and "stopped" only if we actually said we were typing.
+ * If no update arrives for twice the interval, the user has wandered
+ * off and we send the trailing "stopped" ourselves.
+ */
 void chime_conversation_send_typing(ChimeConnection *cxn, ChimeConversation *conv,
 				    gboolean typing)
 {
-	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
-	JsonBuilder *jb = json_builder_new();
+	g_return_if_fail(CHIME_IS_CONNECTION(cxn));
+	g_return_if_fail(CHIME_IS_CONVERSATION(conv));
 
-	jb = json_builder_begin_object(jb);
-	jb = json_builder_set_member_name(jb, "channel");
-	jb = json_builder_add_string_value(jb, conv->channel);
-	jb = json_builder_set_member_name(jb, "data");
-	jb = json_builder_begin_object(jb);
-	jb = json_builder_set_member_name(jb, "klass");
-	jb = json_builder_add_string_value(jb, "TypingIndicator");
-	jb = json_builder_set_member_name(jb, "state");
-	jb = json_builder_add_boolean_value(jb, typing);
-	jb = json_builder_end_object(jb);
-	jb = json_builder_set_member_name(jb, "except");
-	jb = json_builder_begin_array(jb);
-	jb = json_builder_add_string_value(jb, priv->ws_key);
-	jb = json_builder_end_array(jb);
-	jb = json_builder_set_member_name(jb, "type");
-	jb = json_builder_add_string_value(jb, "publish");
-	jb = json_builder_end_object(jb);
+	if (conv->typing_timer) {
+		g_source_remove(conv->typing_timer);
+		conv->typing_timer = 0;
+	}
 
-	JsonNode *node = json_builder_get_root(jb);
-	chime_connection_jugg_send(cxn, node);
+	if (!typing) {
+		if (conv->typing_sent)
+			publish_typing(cxn, conv, FALSE);
+		return;
+	}
 
-	json_node_unref(node);
-	g_object_unref(jb);
+	if (!conv->typing_sent ||
+	    g_get_monotonic_time() - conv->typing_sent_time >= CHIME_TYPING_INTERVAL * G_USEC_PER_SEC)
+		publish_typing(cxn, conv, TRUE);
 
+	if (conv->typing_sent)
+		conv->typing_timer = g_timeout_add_seconds(CHIME_TYPING_INTERVAL * 2,
+							   typing_expired, conv);
 }
 
 gboolean chime_conversation_has_member(ChimeConversation *conv, const gchar *member_id)
@@ -57,6 +57,9 @@ typedef void (*ChimeConversationCB) (ChimeConnection *, ChimeConversation *, gpo
 void chime_connection_foreach_conversation(ChimeConnection *cxn, ChimeConversationCB cb,
 				   gpointer cbdata);
 
+/* Seconds between refreshes of our "typing" state while it continues */
+#define CHIME_TYPING_INTERVAL 5
+
 void chime_conversation_send_typing(ChimeConnection *cxn, ChimeConversation *conv,
 				    gboolean typing);
 
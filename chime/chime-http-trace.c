@@ -0,0 +1,268 @@
+/*
+ * Pidgin/libpurple Chime client plugin
+ *
+ * Copyright © 2017 Amazon.com, Inc. or its affiliates.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "chime-connection-private.h"
+
+#include <string.h>
+
+/*
+ * Each struct chime_msg records when its SoupMessage passes through
+ * the interesting points of its life, from libsoup's network-event
+ * signal (DNS, TCP connect and TLS handshake, which only happen when
+ * a new connection is needed) and the message's own signals. When the
+ * request completes, the gaps between those are broken down into
+ * phases and added to a per-endpoint aggregate, keyed by method, host
+ * and a templated path such as "/rooms/{id}/messages".
+ *
+ * That distinguishes time spent waiting for the server (TTFB) from time
+ * spent on our side (queueing behind other requests, or parsing).
+ */
+#define SLOW_REQUEST_MS 2000
+#define MAX_ENDPOINTS 256
+
+static const gchar *phase_names[CHIME_TRACE_PHASES] = {
+	[CHIME_TRACE_QUEUE] = "queue",
+	[CHIME_TRACE_DNS] = "dns",
+	[CHIME_TRACE_CONNECT] = "connect",
+	[CHIME_TRACE_TLS] = "tls",
+	[CHIME_TRACE_SEND] = "send",
+	[CHIME_TRACE_TTFB] = "ttfb",
+	[CHIME_TRACE_BODY] = "body",
+	[CHIME_TRACE_PARSE] = "parse",
+};
+
+struct endpoint_stats {
+	guint64 count;
+	guint64 slow;
+	gint64 max;			/* µs */
+	gint64 total[CHIME_TRACE_PHASES];	/* µs */
+};
+
+#define STAMP(cmsg, ev) ((cmsg)->trace[CHIME_TRACE_EV_##ev] = g_get_monotonic_time())
+
+static void on_network_event(SoupMessage *msg, GSocketClientEvent event,
+			     GIOStream *connection, gpointer _cmsg)
+{
+	struct chime_msg *cmsg = _cmsg;
+
+	switch (event) {
+	case G_SOCKET_CLIENT_RESOLVING: STAMP(cmsg, RESOLVING); break;
+	case G_SOCKET_CLIENT_RESOLVED: STAMP(cmsg, RESOLVED); break;
+	case G_SOCKET_CLIENT_CONNECTING: STAMP(cmsg, CONNECTING); break;
+	case G_SOCKET_CLIENT_CONNECTED: STAMP(cmsg, CONNECTED); break;
+	case G_SOCKET_CLIENT_TLS_HANDSHAKING: STAMP(cmsg, TLS_START); break;
+	case G_SOCKET_CLIENT_TLS_HANDSHAKED: STAMP(cmsg, TLS_DONE); break;
+	default: break;
+	}
+}
+
+static void on_starting(SoupMessage *msg, gpointer _cmsg)
+{
+	STAMP((struct chime_msg *)_cmsg, STARTING);
+}
+
+static void on_wrote_body(SoupMessage *msg, gpointer _cmsg)
+{
+	STAMP((struct chime_msg *)_cmsg, WROTE_BODY);
+}
+
+static void on_got_headers(SoupMessage *msg, gpointer _cmsg)
+{
+	STAMP((struct chime_msg *)_cmsg, GOT_HEADERS);
+}
+
+static void on_got_body(SoupMessage *msg, gpointer _cmsg)
+{
+	STAMP((struct chime_msg *)_cmsg, GOT_BODY);
+}
+
+void chime_http_trace_start(struct chime_msg *cmsg)
+{
+	/* A message requeued after a token renewal just gets its events
+	 * overwritten; the queue phase then includes the renewal. */
+	if (cmsg->traced)
+		return;
+	cmsg->traced = TRUE;
+
+	g_signal_connect(cmsg->msg, "network-event", G_CALLBACK(on_network_event), cmsg);
+	g_signal_connect(cmsg->msg, "starting", G_CALLBACK(on_starting), cmsg);
+	g_signal_connect(cmsg->msg, "wrote-body", G_CALLBACK(on_wrote_body), cmsg);
+	g_signal_connect(cmsg->msg, "got-headers", G_CALLBACK(on_got_headers), cmsg);
+	g_signal_connect(cmsg->msg, "got-body", G_CALLBACK(on_got_body), cmsg);
+}
+
+static gint64 span(struct chime_msg *cmsg, int from, int to)
+{
+	if (!cmsg->trace[from] || cmsg->trace[to] < cmsg->trace[from])
+		return 0;
+	return cmsg->trace[to] - cmsg->trace[from];
+}
+
+static gboolean is_id(const gchar *seg)
+{
+	gboolean digits = FALSE;
+	int len;
+
+	for (len = 0; seg[len]; len++) {
+		if (g_ascii_isdigit(seg[len]))
+			digits = TRUE;
+	}
+	/* UUIDs, numeric IDs, and tokens. Not version numbers like "v2". */
+	return digits && (len > 8 || strspn(seg, "0123456789") == (size_t)len);
+}
+
+static gchar *endpoint_key(SoupMessage *msg)
+{
+	SoupURI *uri = soup_message_get_uri(msg);
+	gchar **segs = g_strsplit(soup_uri_get_path(uri), "/", -1);
+	int i;
+
+	for (i = 0; segs[i]; i++) {
+		if (is_id(segs[i])) {
+			g_free(segs[i]);
+			segs[i] = g_strdup("{id}");
+		}
+	}
+
+	gchar *path = g_strjoinv("/", segs);
+	gchar *key = g_strdup_printf("%s %s %s", msg->method, soup_uri_get_host(uri), path);
+	g_free(path);
+	g_strfreev(segs);
+	return key;
+}
+
+void chime_http_trace_finish(ChimeConnection *cxn, struct chime_msg *cmsg)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+	gint64 phases[CHIME_TRACE_PHASES] = { 0 };
+	gint64 total;
+	int i;
+
+	g_signal_handlers_disconnect_by_data(cmsg->msg, cmsg);
+
+	phases[CHIME_TRACE_DNS] = span(cmsg, CHIME_TRACE_EV_RESOLVING, CHIME_TRACE_EV_RESOLVED);
+	phases[CHIME_TRACE_CONNECT] = span(cmsg, CHIME_TRACE_EV_CONNECTING, CHIME_TRACE_EV_CONNECTED);
+	phases[CHIME_TRACE_TLS] = span(cmsg, CHIME_TRACE_EV_TLS_START, CHIME_TRACE_EV_TLS_DONE);
+	phases[CHIME_TRACE_SEND] = span(cmsg, CHIME_TRACE_EV_STARTING, CHIME_TRACE_EV_WROTE_BODY);
+	phases[CHIME_TRACE_TTFB] = span(cmsg, CHIME_TRACE_EV_WROTE_BODY, CHIME_TRACE_EV_GOT_HEADERS);
+	phases[CHIME_TRACE_BODY] = span(cmsg, CHIME_TRACE_EV_GOT_HEADERS, CHIME_TRACE_EV_GOT_BODY);
+	phases[CHIME_TRACE_PARSE] = span(cmsg, CHIME_TRACE_EV_PARSE_START, CHIME_TRACE_EV_PARSE_DONE);
+
+	total = g_get_monotonic_time() - cmsg->queued_time;
+
+	/* Whatever isn't accounted for before the request was sent is time
+	 * spent waiting for a connection (or for a token renewal). */
+	if (cmsg->trace[CHIME_TRACE_EV_STARTING]) {
+		phases[CHIME_TRACE_QUEUE] = cmsg->trace[CHIME_TRACE_EV_STARTING] - cmsg->queued_time -
+			phases[CHIME_TRACE_DNS] - phases[CHIME_TRACE_CONNECT] - phases[CHIME_TRACE_TLS];
+		if (phases[CHIME_TRACE_QUEUE] < 0)
+			phases[CHIME_TRACE_QUEUE] = 0;
+	}
+
+	gchar *key = endpoint_key(cmsg->msg);
+
+	if (!priv->http_endpoints)
+		priv->http_endpoints = g_hash_table_new_full(g_str_hash, g_str_equal,
+							     g_free, g_free);
+
+	struct endpoint_stats *st = g_hash_table_lookup(priv->http_endpoints, key);
+	if (!st && g_hash_table_size(priv->http_endpoints) >= MAX_ENDPOINTS) {
+		g_free(key);
+		key = g_strdup("other");
+		st = g_hash_table_lookup(priv->http_endpoints, key);
+	}
+	if (!st) {
+		st = g_new0(struct endpoint_stats, 1);
+		g_hash_table_insert(priv->http_endpoints, g_strdup(key), st);
+	}
+
+	st->count++;
+	if (total > st->max)
+		st->max = total;
+	for (i = 0; i < CHIME_TRACE_PHASES; i++)
+		st->total[i] += phases[i];
+
+	if (total >= SLOW_REQUEST_MS * 1000 || chime_log_enabled(CHIME_LOG_HTTP)) {
+		gboolean slow = total >= SLOW_REQUEST_MS * 1000;
+		GString *str = g_string_new("");
+
+		if (slow)
+			st->slow++;
+
+		for (i = 0; i < CHIME_TRACE_PHASES; i++) {
+			if (phases[i])
+				g_string_append_printf(str, " %s %" G_GINT64_FORMAT "ms",
+						       phase_names[i], phases[i] / 1000);
+		}
+		chime_connection_log_cat(cxn, CHIME_LOG_HTTP,
+					 slow ? CHIME_LOGLVL_WARNING : CHIME_LOGLVL_MISC,
+					 "%s request %s (%d): %" G_GINT64_FORMAT "ms:%s\n",
+					 slow ? "Slow" : "Completed", key,
+					 cmsg->msg->status_code, total / 1000, str->str);
+		g_string_free(str, TRUE);
+	}
+
+	g_free(key);
+}
+
+void chime_http_trace_append_metrics(ChimeConnection *cxn, GString *out)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+	GHashTableIter iter;
+	gpointer key, val;
+	gchar secs[G_ASCII_DTOSTR_BUF_SIZE];
+	int i;
+
+	if (!priv->http_endpoints)
+		return;
+
+	g_string_append(out, "# HELP chime_http_endpoint_requests_total Requests completed per endpoint\n"
+			"# TYPE chime_http_endpoint_requests_total counter\n"
+			"# HELP chime_http_endpoint_slow_total Requests per endpoint which took over "
+			G_STRINGIFY(SLOW_REQUEST_MS) "ms\n"
+			"# TYPE chime_http_endpoint_slow_total counter\n"
+			"# HELP chime_http_endpoint_phase_seconds_total Time spent per endpoint in each phase\n"
+			"# TYPE chime_http_endpoint_phase_seconds_total counter\n"
+			"# HELP chime_http_endpoint_max_seconds Slowest request per endpoint\n"
+			"# TYPE chime_http_endpoint_max_seconds gauge\n");
+
+	g_hash_table_iter_init(&iter, priv->http_endpoints);
+	while (g_hash_table_iter_next(&iter, &key, &val)) {
+		struct endpoint_stats *st = val;
+		gchar **parts = g_strsplit(key, " ", 3);
+		gchar *labels;
+
+		if (g_strv_length(parts) == 3)
+			labels = g_strdup_printf("method=\"%s\",host=\"%s\",path=\"%s\"",
+						 parts[0], parts[1], parts[2]);
+		else
+			labels = g_strdup_printf("path=\"%s\"", (gchar *)key);
+		g_strfreev(parts);
+
+		g_string_append_printf(out, "chime_http_endpoint_requests_total{%s} %" G_GUINT64_FORMAT "\n",
+				       labels, st->count);
+		g_string_append_printf(out, "chime_http_endpoint_slow_total{%s} %" G_GUINT64_FORMAT "\n",
+				       labels, st->slow);
+		g_ascii_dtostr(secs, sizeof(secs), (gdouble)st->max / G_USEC_PER_SEC);
+		g_string_append_printf(out, "chime_http_endpoint_max_seconds{%s} %s\n",
+				       labels, secs);
+		for (i = 0; i < CHIME_TRACE_PHASES; i++) {
+			g_ascii_dtostr(secs, sizeof(secs), (gdouble)st->total[i] / G_USEC_PER_SEC);
+			g_string_append_printf(out, "chime_http_endpoint_phase_seconds_total{%s,phase=\"%s\"} %s\n",
+					       labels, phase_names[i], secs);
+		}
+		g_free(labels);
+	}
+}
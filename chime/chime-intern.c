@@ -0,0 +1,87 @@
+/*
+ * Pidgin/libpurple Chime client plugin
+ *
+ * Copyright © 2017 Amazon.com, Inc. or its affiliates.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "chime-connection-private.h"
+
+#include <string.h>
+
+/*
+ * A process-wide pool of reference-counted, immutable strings. When many
+ * connections run in one process they each have their own ChimeContact
+ * for every colleague they share, and the IDs, e-mail addresses, names
+ * and channel names of those would otherwise be duplicated for each.
+ * Unlike g_intern_string(), entries are freed again when the last user
+ * lets go, so it doesn't grow without bound as the directory churns.
+ */
+struct intern_entry {
+	guint refs;
+	gchar str[];
+};
+
+static GMutex intern_lock;
+static GHashTable *intern_pool;	/* entry->str → entry */
+
+const gchar *chime_intern(const gchar *str)
+{
+	struct intern_entry *entry;
+
+	if (!str)
+		return NULL;
+
+	g_mutex_lock(&intern_lock);
+	if (!intern_pool)
+		intern_pool = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+
+	entry = g_hash_table_lookup(intern_pool, str);
+	if (!entry) {
+		gsize len = strlen(str);
+
+		entry = g_malloc(sizeof(*entry) + len + 1);
+		entry->refs = 0;
+		memcpy(entry->str, str, len + 1);
+		g_hash_table_insert(intern_pool, entry->str, entry);
+	}
+	entry->refs++;
+	g_mutex_unlock(&intern_lock);
+
+	return entry->str;
+}
+
+void chime_unintern(const gchar *str)
+{
+	struct intern_entry *entry;
+
+	if (!str)
+		return;
+
+	g_mutex_lock(&intern_lock);
+	entry = g_hash_table_lookup(intern_pool, str);
+	if (!entry || entry->str != str)
+		g_warning("Uninterning string %p not from the pool", str);
+	else if (!--entry->refs)
+		g_hash_table_remove(intern_pool, str);
+	g_mutex_unlock(&intern_lock);
+}
+
+/* Replace an interned field, returning TRUE if it actually changed */
+gboolean chime_intern_replace(const gchar **field, const gchar *str)
+{
+	if (!g_strcmp0(*field, str))
+		return FALSE;
+
+	chime_unintern(*field);
+	*field = chime_intern(str);
+	return TRUE;
+}
@@ -0,0 +1,131 @@
+/*
+ * Pidgin/libpurple Chime client plugin
+ *
+ * Copyright © 2017 Amazon.com, Inc. or its affiliates.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "chime-connection-private.h"
+
+/*
+ * A minimal JSON writer for the small, fixed-shape bodies which we send
+ * most often (typing indicators, presence, last-read markers). Going via
+ * JsonBuilder and JsonGenerator costs dozens of allocations for each of
+ * those; this writes straight into a buffer which the connection keeps
+ * and reuses, and the body is copied once into the SoupMessage.
+ *
+ * Separators are inferred from the last character written, so callers
+ * just emit members and values in order:
+ *
+ *	GString *s = chime_connection_json_buf(cxn);
+ *	chime_json_begin_object(s, NULL);
+ *	chime_json_add_string(s, "Status", status);
+ *	chime_json_end_object(s);
+ */
+
+GString *chime_connection_json_buf(ChimeConnection *cxn)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+
+	if (!priv->json_buf)
+		priv->json_buf = g_string_sized_new(256);
+	else
+		g_string_truncate(priv->json_buf, 0);
+
+	return priv->json_buf;
+}
+
+static void json_escape(GString *s, const gchar *str)
+{
+	const gchar *run = str;
+
+	g_string_append_c(s, '"');
+	for (; *str; str++) {
+		guchar c = *str;
+
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+
+		g_string_append_len(s, run, str - run);
+		run = str + 1;
+
+		switch (c) {
+		case '"': g_string_append(s, "\\\""); break;
+		case '\\': g_string_append(s, "\\\\"); break;
+		case '\n': g_string_append(s, "\\n"); break;
+		case '\r': g_string_append(s, "\\r"); break;
+		case '\t': g_string_append(s, "\\t"); break;
+		case '\b': g_string_append(s, "\\b"); break;
+		case '\f': g_string_append(s, "\\f"); break;
+		default: g_string_append_printf(s, "\\u%04x", c); break;
+		}
+	}
+	g_string_append_len(s, run, str - run);
+	g_string_append_c(s, '"');
+}
+
+/* Emit the separator if needed, and the member name if there is one */
+static void json_member(GString *s, const gchar *name)
+{
+	if (s->len) {
+		gchar last = s->str[s->len - 1];
+
+		if (last != '{' && last != '[' && last != ':')
+			g_string_append_c(s, ',');
+	}
+	if (name) {
+		json_escape(s, name);
+		g_string_append_c(s, ':');
+	}
+}
+
+void chime_json_begin_object(GString *s, const gchar *name)
+{
+	json_member(s, name);
+	g_string_append_c(s, '{');
+}
+
+void chime_json_end_object(GString *s)
+{
+	g_string_append_c(s, '}');
+}
+
+void chime_json_begin_array(GString *s, const gchar *name)
+{
+	json_member(s, name);
+	g_string_append_c(s, '[');
+}
+
+void chime_json_end_array(GString *s)
+{
+	g_string_append_c(s, ']');
+}
+
+void chime_json_add_string(GString *s, const gchar *name, const gchar *val)
+{
+	json_member(s, name);
+	if (val)
+		json_escape(s, val);
+	else
+		g_string_append(s, "null");
+}
+
+void chime_json_add_boolean(GString *s, const gchar *name, gboolean val)
+{
+	json_member(s, name);
+	g_string_append(s, val ? "true" : "false");
+}
+
+void chime_json_add_int(GString *s, const gchar *name, gint64 val)
+{
+	json_member(s, name);
+	g_string_append_printf(s, "%" G_GINT64_FORMAT, val);
+}
@@ -94,14 +94,18 @@ static void handle_callback(ChimeConnection *cxn, const gchar *msg)
 			    }
 		}
 	}
-	if (!handled) {
+	if (!handled)
+		chime_metric_inc(cxn, CHIME_METRIC_JUGG_UNHANDLED);
+	if (!handled && (chime_log_level_enabled(CHIME_LOGLVL_INFO) ||
+			 chime_log_enabled(CHIME_LOG_JUGG))) {
 		JsonGenerator *gen = json_generator_new();
 		json_generator_set_root(gen, r);
 		json_generator_set_pretty(gen, TRUE);
 
 		gchar *data = json_generator_to_data(gen, NULL);
-		chime_connection_log(cxn, CHIME_LOGLVL_INFO, "Unhandled jugg msg on channel '%s': %s\n",
-				     channel, data);
+		chime_connection_log_cat(cxn, CHIME_LOG_JUGG, CHIME_LOGLVL_INFO,
+					 "Unhandled jugg msg on channel '%s': %s\n",
+					 channel, data);
 		g_free(data);
 		g_object_unref(gen);
 	}
@@ -118,14 +122,22 @@ static void jugg_send(ChimeConnection *cxn, const gchar *fmt, ...)
 	str = g_strdup_vprintf(fmt, args);
 	va_end(args);
 
-	chime_connection_log(cxn, CHIME_LOGLVL_MISC, "Send juggernaut msg: %s\n", str);
+	chime_connection_log_cat(cxn, CHIME_LOG_JUGG, CHIME_LOGLVL_MISC,
+				 "Send juggernaut msg: %s\n", str);
 	soup_websocket_connection_send_text(priv->ws_conn, str);
 	g_free(str);
 }
 
 static void send_subscription_message(ChimeConnection *cxn, const gchar *type, const gchar *channel)
 {
-	jugg_send(cxn, "3:::{\"type\":\"%s\",\"channel\":\"%s\"}", type, channel);
+	GString *body = chime_connection_json_buf(cxn);
+
+	chime_json_begin_object(body, NULL);
+	chime_json_add_string(body, "type", type);
+	chime_json_add_string(body, "channel", channel);
+	chime_json_end_object(body);
+
+	chime_connection_jugg_send_json(cxn, body);
 }
 
 static void on_websocket_message(SoupWebsocketConnection *ws, gint type,
@@ -140,9 +152,10 @@ static void on_websocket_message(SoupWebsocketConnection *ws, gint type,
 		return;
 
 	data = g_bytes_get_data(message, NULL);
+	chime_metric_inc(cxn, CHIME_METRIC_JUGG_MESSAGES);
 
-	chime_connection_log(cxn, CHIME_LOGLVL_MISC,
-			     "websocket message received:\n'%s'\n", (char *)data);
+	chime_connection_log_cat(cxn, CHIME_LOG_JUGG, CHIME_LOGLVL_MISC,
+				 "websocket message received:\n'%s'\n", (char *)data);
 
 	/* DISCONNECT */
 	if (!strcmp(data, "0::")) {
@@ -171,8 +184,13 @@ static void on_websocket_message(SoupWebsocketConnection *ws, gint type,
 		/* Send an ack */
 		jugg_send(cxn, "6:::%s", parms[1]);
 
-		if (priv->subscriptions && !strcmp(parms[0], "3") && parms[3])
+		if (priv->subscriptions && !strcmp(parms[0], "3") && parms[3]) {
+			struct chime_scope scope;
+
+			chime_scope_enter(&scope, "jugg", NULL);
 			handle_callback(cxn, parms[3]);
+			chime_scope_exit(&scope);
+		}
 	}
 	g_strfreev(parms);
 }
@@ -182,7 +200,7 @@ static gboolean pong_timeout(gpointer _cxn)
 	ChimeConnection *cxn = CHIME_CONNECTION(_cxn);
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
 
-	chime_connection_log(cxn, CHIME_LOGLVL_MISC, "WebSocket keepalive timeout\n");
+	chime_connection_log_cat(cxn, CHIME_LOG_JUGG, CHIME_LOGLVL_MISC, "WebSocket keepalive timeout\n");
 	priv->keepalive_timer = 0;
 
 	/* If we got at least as far as receiving the '1::' connect message,
@@ -202,8 +220,8 @@ static void on_websocket_pong(SoupWebsocketConnection *ws,
 	ChimeConnection *cxn = CHIME_CONNECTION(_cxn);
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
 
-	chime_connection_log(cxn, CHIME_LOGLVL_MISC, "WebSocket pong received (%s)\n",
-			     g_bytes_get_data(data, NULL));
+	chime_connection_log_cat(cxn, CHIME_LOG_JUGG, CHIME_LOGLVL_MISC, "WebSocket pong received (%s)\n",
+				 (gchar *)g_bytes_get_data(data, NULL));
 
 	g_source_remove(priv->keepalive_timer);
 	priv->keepalive_timer = g_timeout_add_seconds(KEEPALIVE_INTERVAL * 3, pong_timeout, cxn);
@@ -400,6 +418,23 @@ gboolean chime_connection_jugg_send(ChimeConnection *cxn, JsonNode *node)
 	return TRUE;
 }
 
+/* The body is built in place, so it can take the message type prefix
+ * without another copy. */
+gboolean chime_connection_jugg_send_json(ChimeConnection *cxn, GString *body)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+
+	if (!priv->ws_conn)
+		return FALSE;
+
+	g_string_prepend(body, "3:::");
+	chime_connection_log_cat(cxn, CHIME_LOG_JUGG, CHIME_LOGLVL_MISC,
+				 "Send juggernaut msg: %s\n", body->str);
+	soup_websocket_connection_send_text(priv->ws_conn, body->str);
+
+	return TRUE;
+}
+
 /*
  * We allow multiple subscribers to a channel, as long as {cb, cb_data, klass}
  * is unique.
@@ -0,0 +1,262 @@
+/*
+ * Pidgin/libpurple Chime client plugin
+ *
+ * Copyright © 2017 Amazon.com, Inc. or its affiliates.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "chime-connection-private.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/*
+ * The environment is only looked at once, and the results cached in
+ * chime_log_categories and chime_log_threshold. The chime_debug_cat()
+ * and chime_connection_log() macros test those before evaluating any
+ * of their arguments, so a disabled message costs a load and a compare.
+ *
+ * CHIME_DEBUG may be a comma-separated list of categories as accepted
+ * by g_parse_debug_string() (e.g. "audio,jugg" or "all"), or a number
+ * as it was historically: any number enables the general debug output,
+ * 1 adds the HTTP logger and 2 adds it for the signin session too.
+ * "memory" and "latency" turn on process-wide instrumentation rather
+ * than just logging, so "all" leaves them out; they must be named.
+ * CHIME_AUDIO_DEBUG and CHIME_SCREEN_DEBUG still enable packet dumps.
+ *
+ * Everything which is formatted, along with anything at INFO level or
+ * above, is also kept in a ring buffer of binary records so that the
+ * recent history is available after the event (see the "Show recent
+ * debug log" action in the prpl) without having had debugging enabled.
+ */
+#define CHIME_LOG_RING_SIZE (256 * 1024)
+#define CHIME_LOG_RING_MAX_MSG 2048
+#define CHIME_LOG_RING_LEVEL CHIME_LOGLVL_INFO
+
+guint chime_log_categories;
+ChimeLogLevel chime_log_threshold = CHIME_LOGLVL_MISC;
+static ChimeLogLevel chime_log_emit_level = CHIME_LOGLVL_MISC;
+
+static const GDebugKey log_keys[] = {
+	{ "misc", CHIME_LOG_MISC },
+	{ "jugg", CHIME_LOG_JUGG },
+	{ "http", CHIME_LOG_HTTP },
+	{ "signin", CHIME_LOG_SIGNIN },
+	{ "audio", CHIME_LOG_AUDIO },
+	{ "screen", CHIME_LOG_SCREEN },
+	{ "sync", CHIME_LOG_SYNC },
+	{ "audio-packets", CHIME_LOG_AUDIO_PACKETS },
+	{ "screen-packets", CHIME_LOG_SCREEN_PACKETS },
+	{ "memory", CHIME_LOG_MEMORY },
+	{ "latency", CHIME_LOG_LATENCY },
+};
+
+#define CHIME_LOG_OPT_IN (CHIME_LOG_MEMORY | CHIME_LOG_LATENCY)
+
+/* The opt-in categories which are named explicitly in @env */
+static guint parse_opt_in(const gchar *env)
+{
+	gchar **toks = g_strsplit_set(env, ":;, \t", -1);
+	guint flags = 0, i, j;
+
+	for (i = 0; toks[i]; i++) {
+		for (j = 0; j < G_N_ELEMENTS(log_keys); j++) {
+			if ((log_keys[j].value & CHIME_LOG_OPT_IN) &&
+			    !g_ascii_strcasecmp(toks[i], log_keys[j].key))
+				flags |= log_keys[j].value;
+		}
+	}
+	g_strfreev(toks);
+	return flags;
+}
+
+struct ring_hdr {
+	gint64 time;
+	guint16 len;
+	guint8 level;
+	guint8 category;	/* Index into log_keys, or 0xff */
+};
+
+static struct {
+	GMutex lock;
+	gsize head;	/* Offset of the next write */
+	gsize used;
+	gchar buf[CHIME_LOG_RING_SIZE];
+} ring;
+
+void chime_log_init(void)
+{
+	static gsize inited;
+
+	if (!g_once_init_enter(&inited))
+		return;
+
+	const gchar *env = getenv("CHIME_DEBUG");
+	guint flags = 0;
+
+	if (env && g_ascii_isdigit(env[0])) {
+		int lvl = atoi(env);
+
+		flags = CHIME_LOG_MISC | CHIME_LOG_JUGG | CHIME_LOG_AUDIO |
+			CHIME_LOG_SCREEN | CHIME_LOG_SYNC;
+		if (lvl > 0)
+			flags |= CHIME_LOG_HTTP;
+		if (lvl > 1)
+			flags |= CHIME_LOG_SIGNIN;
+	} else if (env) {
+		flags = g_parse_debug_string(env, log_keys, G_N_ELEMENTS(log_keys));
+		flags = (flags & ~CHIME_LOG_OPT_IN) | parse_opt_in(env);
+		/* A bare CHIME_DEBUG= still means what it always did */
+		if (!flags)
+			flags = CHIME_LOG_MISC;
+	}
+	if (getenv("CHIME_AUDIO_DEBUG"))
+		flags |= CHIME_LOG_AUDIO_PACKETS;
+	if (getenv("CHIME_SCREEN_DEBUG"))
+		flags |= CHIME_LOG_SCREEN_PACKETS;
+
+	chime_log_categories = flags;
+
+	g_once_init_leave(&inited, 1);
+}
+
+void chime_log_set_level(ChimeLogLevel level)
+{
+	chime_log_emit_level = level;
+	chime_log_threshold = MIN(level, CHIME_LOG_RING_LEVEL);
+}
+
+static guint8 category_index(guint category)
+{
+	guint8 i;
+
+	for (i = 0; i < G_N_ELEMENTS(log_keys); i++) {
+		if (log_keys[i].value == category)
+			return i;
+	}
+	return 0xff;
+}
+
+static void ring_write(gconstpointer data, gsize len)
+{
+	gsize first = MIN(len, CHIME_LOG_RING_SIZE - ring.head);
+
+	memcpy(ring.buf + ring.head, data, first);
+	memcpy(ring.buf, (const gchar *)data + first, len - first);
+	ring.head = (ring.head + len) % CHIME_LOG_RING_SIZE;
+}
+
+static void ring_read(const gchar *buf, gsize offset, gpointer data, gsize len)
+{
+	gsize first = MIN(len, CHIME_LOG_RING_SIZE - offset);
+
+	memcpy(data, buf + offset, first);
+	memcpy((gchar *)data + first, buf, len - first);
+}
+
+static void ring_append(guint category, ChimeLogLevel level, const gchar *str)
+{
+	struct ring_hdr hdr;
+	gsize len = strlen(str);
+
+	while (len && str[len - 1] == '\n')
+		len--;
+	if (len > CHIME_LOG_RING_MAX_MSG) {
+		/* Cut at the start of the character which would overrun */
+		const gchar *end = g_utf8_find_prev_char(str, str + CHIME_LOG_RING_MAX_MSG + 1);
+
+		len = end ? end - str : CHIME_LOG_RING_MAX_MSG;
+	}
+
+	hdr.time = g_get_real_time();
+	hdr.len = len;
+	hdr.level = level;
+	hdr.category = category_index(category);
+
+	g_mutex_lock(&ring.lock);
+
+	/* Drop the oldest records until there's room */
+	while (ring.used + sizeof(hdr) + len > CHIME_LOG_RING_SIZE) {
+		struct ring_hdr old;
+		gsize tail = (ring.head + CHIME_LOG_RING_SIZE - ring.used) % CHIME_LOG_RING_SIZE;
+
+		ring_read(ring.buf, tail, &old, sizeof(old));
+		ring.used -= sizeof(old) + old.len;
+	}
+
+	ring_write(&hdr, sizeof(hdr));
+	ring_write(str, len);
+	ring.used += sizeof(hdr) + len;
+
+	g_mutex_unlock(&ring.lock);
+}
+
+void chime_log_ring_foreach(ChimeLogRingFunc fn, gpointer user_data)
+{
+	gchar *buf = g_malloc(CHIME_LOG_RING_SIZE);
+	gsize used, off;
+
+	/* Take a copy so the callback can log without deadlocking */
+	g_mutex_lock(&ring.lock);
+	memcpy(buf, ring.buf, CHIME_LOG_RING_SIZE);
+	used = ring.used;
+	off = (ring.head + CHIME_LOG_RING_SIZE - used) % CHIME_LOG_RING_SIZE;
+	g_mutex_unlock(&ring.lock);
+
+	while (used) {
+		struct ring_hdr hdr;
+		gchar msg[CHIME_LOG_RING_MAX_MSG + 1];
+
+		ring_read(buf, off, &hdr, sizeof(hdr));
+		off = (off + sizeof(hdr)) % CHIME_LOG_RING_SIZE;
+		ring_read(buf, off, msg, hdr.len);
+		msg[hdr.len] = 0;
+		off = (off + hdr.len) % CHIME_LOG_RING_SIZE;
+		used -= sizeof(hdr) + hdr.len;
+
+		fn(hdr.time, hdr.level,
+		   hdr.category < G_N_ELEMENTS(log_keys) ? log_keys[hdr.category].key : NULL,
+		   msg, user_data);
+	}
+
+	g_free(buf);
+}
+
+void chime_log_debug(guint category, const gchar *format, ...)
+{
+	va_list args;
+	gchar *str;
+
+	va_start(args, format);
+	str = g_strdup_vprintf(format, args);
+	va_end(args);
+
+	fputs(str, stdout);
+	ring_append(category, CHIME_LOGLVL_MISC, str);
+	g_free(str);
+}
+
+void chime_connection_do_log(ChimeConnection *cxn, guint category, ChimeLogLevel level,
+			     const gchar *format, ...)
+{
+	va_list args;
+	gchar *str;
+
+	va_start(args, format);
+	str = g_strdup_vprintf(format, args);
+	va_end(args);
+
+	ring_append(category, level, str);
+	if (level >= chime_log_emit_level)
+		chime_connection_emit_log(cxn, level, str);
+	g_free(str);
+}
@@ -77,6 +77,9 @@ struct _ChimeMeeting {
 	/* For open meetings */
 	guint opens;
 	ChimeConnection *cxn;
+
+	guint warmup_timer;
+	gboolean warmed_up;
 };
 
 G_DEFINE_TYPE(ChimeMeeting, chime_meeting, CHIME_TYPE_OBJECT)
@@ -99,6 +102,11 @@ chime_meeting_dispose(GObject *object)
 	close_meeting(NULL, self, NULL);
 	g_signal_emit(self, signals[ENDED], 0, NULL);
 
+	if (self->warmup_timer) {
+		g_source_remove(self->warmup_timer);
+		self->warmup_timer = 0;
+	}
+
 	g_clear_object(&self->call);
 
 	G_OBJECT_CLASS(chime_meeting_parent_class)->dispose(object);
@@ -117,6 +125,8 @@ chime_meeting_finalize(GObject *object)
 	if (self->chat_room)
 		g_object_unref(self->chat_room);
 
+	chime_mem_account(CHIME_MEM_MEETING, -(gssize)sizeof(*self), -1);
+
 	G_OBJECT_CLASS(chime_meeting_parent_class)->finalize(object);
 }
 
@@ -219,6 +229,7 @@ static void chime_meeting_class_init(ChimeMeetingClass *klass)
 
 static void chime_meeting_init(ChimeMeeting *self)
 {
+	chime_mem_account(CHIME_MEM_MEETING, sizeof(*self), 1);
 }
 
 const gchar *chime_meeting_get_id(ChimeMeeting *self)
@@ -301,6 +312,51 @@ static gboolean parse_meeting_type(JsonNode *node, const gchar *member, ChimeMee
 	return TRUE;
 }
 
+/*
+ * Live meetings are indexed by both passcode and display ID so that PIN
+ * joins don't have to walk the whole collection, and the set of live
+ * (joinable) meetings is kept separately from the collection, which also
+ * holds dead meetings until they're disposed. The hash keys are the
+ * strings in the meeting itself, so they must be unindexed before those
+ * change.
+ */
+static void unindex_meeting_pins(ChimeConnectionPrivate *priv, ChimeMeeting *meeting)
+{
+	if (meeting->passcode &&
+	    g_hash_table_lookup(priv->meetings_by_pin, meeting->passcode) == meeting)
+		g_hash_table_remove(priv->meetings_by_pin, meeting->passcode);
+	if (meeting->meeting_id_for_display &&
+	    g_hash_table_lookup(priv->meetings_by_pin, meeting->meeting_id_for_display) == meeting)
+		g_hash_table_remove(priv->meetings_by_pin, meeting->meeting_id_for_display);
+}
+
+static void index_meeting_pins(ChimeConnectionPrivate *priv, ChimeMeeting *meeting)
+{
+	if (chime_object_is_dead(CHIME_OBJECT(meeting)))
+		return;
+
+	if (meeting->passcode)
+		g_hash_table_insert(priv->meetings_by_pin, meeting->passcode, meeting);
+	if (meeting->meeting_id_for_display)
+		g_hash_table_insert(priv->meetings_by_pin, meeting->meeting_id_for_display, meeting);
+}
+
+static void meeting_dead_changed(ChimeMeeting *meeting, GParamSpec *pspec, ChimeConnection *cxn)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE(cxn);
+
+	if (!priv->meetings_by_pin || !priv->joinable_meetings)
+		return;
+
+	if (chime_object_is_dead(CHIME_OBJECT(meeting))) {
+		unindex_meeting_pins(priv, meeting);
+		g_hash_table_remove(priv->joinable_meetings, meeting);
+	} else {
+		index_meeting_pins(priv, meeting);
+		g_hash_table_add(priv->joinable_meetings, meeting);
+	}
+}
+
 static ChimeMeeting *chime_connection_parse_meeting(ChimeConnection *cxn, JsonNode *node,
 						    GError **error)
 {
@@ -369,24 +425,30 @@ static ChimeMeeting *chime_connection_parse_meeting(ChimeConnection *cxn, JsonNo
 		meeting->call = call;
 		chime_object_collection_hash_object(&priv->meetings, CHIME_OBJECT(meeting), TRUE);
 
+		index_meeting_pins(priv, meeting);
+		g_hash_table_add(priv->joinable_meetings, meeting);
+		g_signal_connect(meeting, "notify::dead", G_CALLBACK(meeting_dead_changed), cxn);
+
 		/* Emit signal on ChimeConnection to admit existence of new meeting */
 		chime_connection_new_meeting(cxn, meeting);
 
 		return meeting;
 	}
 
-	if (name && g_strcmp0(name, chime_object_get_name(CHIME_OBJECT(meeting)))) {
+	/* Hold notifications until the PIN index is consistent again */
+	g_object_freeze_notify(G_OBJECT(meeting));
+	unindex_meeting_pins(priv, meeting);
+
+	if (name && g_strcmp0(name, chime_object_get_name(CHIME_OBJECT(meeting))))
 		chime_object_rename(CHIME_OBJECT(meeting), name);
-		g_object_notify(G_OBJECT(meeting), "name");
-	}
 	if (type != meeting->type) {
 		meeting->type = type;
-		g_object_notify(G_OBJECT(meeting), "type");
+		g_object_notify_by_pspec(G_OBJECT(meeting), props[PROP_TYPE]);
 	}
 	if (chat_room_id && g_strcmp0(chat_room_id, meeting->chat_room_id)) {
 		g_free(meeting->chat_room_id);
 		meeting->chat_room_id = g_strdup(chat_room_id);
-		g_object_notify(G_OBJECT(meeting), "chat-room-id");
+		g_object_notify_by_pspec(G_OBJECT(meeting), props[PROP_CHAT_ROOM_ID]);
 	}
 	/* Don't overwrite passcode with a shorter but matching one (which
 	   would be replacing the 13-digit personal passcode with a 10-digit
@@ -399,7 +461,7 @@ static ChimeMeeting *chime_connection_parse_meeting(ChimeConnection *cxn, JsonNo
 	if (organiser && organiser != meeting->organiser) {
 		g_object_unref(meeting->organiser);
 		meeting->organiser = organiser;
-		g_object_notify(G_OBJECT(meeting), "organiser");
+		g_object_notify_by_pspec(G_OBJECT(meeting), props[PROP_ORGANISER]);
 	} else
 		g_object_unref(organiser);
 
@@ -408,6 +470,9 @@ static ChimeMeeting *chime_connection_parse_meeting(ChimeConnection *cxn, JsonNo
 
 	chime_object_collection_hash_object(&priv->meetings, CHIME_OBJECT(meeting), TRUE);
 
+	index_meeting_pins(priv, meeting);
+	g_object_thaw_notify(G_OBJECT(meeting));
+
 	return meeting;
 }
 
@@ -492,6 +557,8 @@ void chime_init_meetings(ChimeConnection *cxn)
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
 
 	chime_object_collection_init(cxn, &priv->meetings);
+	priv->meetings_by_pin = g_hash_table_new(g_str_hash, g_str_equal);
+	priv->joinable_meetings = g_hash_table_new(g_direct_hash, g_direct_equal);
 
 	chime_jugg_subscribe(cxn, priv->device_channel, "JoinableMeetings",
 			     joinable_meetings_jugg_cb, NULL);
@@ -506,6 +573,11 @@ void chime_init_meetings(ChimeConnection *cxn)
 	fetch_meetings(cxn, NULL);
 }
 
+static void unwatch_meeting(gpointer key, gpointer val, gpointer cxn)
+{
+	g_signal_handlers_disconnect_by_func(val, meeting_dead_changed, cxn);
+}
+
 void chime_destroy_meetings(ChimeConnection *cxn)
 {
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
@@ -521,18 +593,49 @@ void chime_destroy_meetings(ChimeConnection *cxn)
 	chime_jugg_unsubscribe(cxn, priv->device_channel, "Webinar",
 			     meeting_jugg_cb, NULL);
 
-	if (priv->meetings.by_id)
+	if (priv->meetings.by_id) {
+		g_hash_table_foreach(priv->meetings.by_id, unwatch_meeting, cxn);
 		g_hash_table_foreach(priv->meetings.by_id, close_meeting, NULL);
+	}
 
+	/* The collection doesn't notify "dead" as it drops its references */
+	g_clear_pointer(&priv->meetings_by_pin, g_hash_table_unref);
+	g_clear_pointer(&priv->joinable_meetings, g_hash_table_unref);
 	chime_object_collection_destroy(&priv->meetings);
 }
 
 gboolean chime_meeting_match_pin(ChimeMeeting *self, const gchar *pin)
 {
-	return !strcmp(pin, self->passcode) ||
+	return !g_strcmp0(pin, self->passcode) ||
 		!g_strcmp0(pin, self->meeting_id_for_display);
 }
 
+ChimeMeeting *chime_connection_meeting_by_pin(ChimeConnection *cxn,
+					      const gchar *pin)
+{
+	g_return_val_if_fail(CHIME_IS_CONNECTION(cxn), NULL);
+	g_return_val_if_fail(pin, NULL);
+
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+
+	if (!priv->meetings_by_pin)
+		return NULL;
+
+	return g_hash_table_lookup(priv->meetings_by_pin, pin);
+}
+
+guint chime_connection_joinable_meeting_count(ChimeConnection *cxn)
+{
+	g_return_val_if_fail(CHIME_IS_CONNECTION(cxn), 0);
+
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+
+	if (!priv->joinable_meetings)
+		return 0;
+
+	return g_hash_table_size(priv->joinable_meetings);
+}
+
 ChimeMeeting *chime_connection_meeting_by_name(ChimeConnection *cxn,
 					 const gchar *name)
 {
@@ -560,8 +663,16 @@ void chime_connection_foreach_meeting(ChimeConnection *cxn, ChimeMeetingCB cb,
 {
 	g_return_if_fail(CHIME_IS_CONNECTION(cxn));
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE(cxn);
+	GHashTableIter iter;
+	gpointer mtg;
+
+	if (!priv->joinable_meetings)
+		return;
 
-	chime_object_collection_foreach_object(cxn, &priv->meetings, (ChimeObjectCB)cb, cbdata);
+	/* Only the live ones; no need to skip over the dead */
+	g_hash_table_iter_init(&iter, priv->joinable_meetings);
+	while (g_hash_table_iter_next(&iter, &mtg, NULL))
+		cb(cxn, CHIME_MEETING(mtg), cbdata);
 }
 
 static void close_meeting(gpointer key, gpointer val, gpointer data)
@@ -799,7 +910,11 @@ static void join_got_room(GObject *source, GAsyncResult *result, gpointer user_d
 	GTask *task = G_TASK(user_data);
 	ChimeMeeting *meeting = CHIME_MEETING(g_task_get_task_data(task));
 
-	meeting->chat_room = room;
+	/* A warmup may have fetched it in the meantime */
+	if (!meeting->chat_room)
+		meeting->chat_room = room;
+	else if (room)
+		g_object_unref(room);
 
 	chime_connection_open_meeting(cxn, meeting, task);
 }
@@ -818,7 +933,7 @@ void chime_connection_join_meeting_async(ChimeConnection *cxn,
 	if (muted)
 		g_object_set_data(G_OBJECT(task), "call-muted", GUINT_TO_POINTER(1));
 
-	if (meeting->chat_room_id) {
+	if (meeting->chat_room_id && !meeting->chat_room) {
 		ChimeRoom *room = chime_connection_room_by_id(cxn, meeting->chat_room_id);
 		if (room) {
 			meeting->chat_room = g_object_ref(room);
@@ -843,6 +958,75 @@ ChimeMeeting *chime_connection_join_meeting_finish(ChimeConnection *self,
 	return g_task_propagate_pointer(G_TASK(result), error);
 }
 
+static void warmup_got_room(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	ChimeConnection *cxn = CHIME_CONNECTION(source);
+	ChimeRoom *room = chime_connection_fetch_room_finish(cxn, result, NULL);
+	ChimeMeeting *meeting = CHIME_MEETING(user_data);
+
+	if (!meeting->chat_room)
+		meeting->chat_room = room;
+	else if (room)
+		g_object_unref(room);
+
+	g_object_unref(meeting);
+}
+
+static gboolean do_warm_up_meeting(gpointer _meeting)
+{
+	ChimeMeeting *meeting = CHIME_MEETING(_meeting);
+	ChimeConnection *cxn = chime_object_get_connection(CHIME_OBJECT(meeting));
+
+	meeting->warmup_timer = 0;
+
+	if (!cxn || meeting->opens || chime_object_is_dead(CHIME_OBJECT(meeting)))
+		return FALSE;
+
+	chime_debug("Warming up meeting %s\n", chime_meeting_get_name(meeting));
+	meeting->warmed_up = TRUE;
+
+	/* Everything chime_connection_join_meeting_async() would otherwise
+	 * have to wait for before it can start the call. */
+	if (meeting->chat_room_id && !meeting->chat_room) {
+		ChimeRoom *room = chime_connection_room_by_id(cxn, meeting->chat_room_id);
+		if (room)
+			meeting->chat_room = g_object_ref(room);
+		else
+			chime_connection_fetch_room_async(cxn, meeting->chat_room_id, NULL,
+							  warmup_got_room, g_object_ref(meeting));
+	}
+
+	chime_call_warm_up(meeting->call);
+
+	return FALSE;
+}
+
+/*
+ * Prepare to join a meeting which starts within @lead_minutes, or at
+ * that point if it's later: fetch its chat room and resolve the media
+ * host, so that joining doesn't have to wait for them.
+ */
+void chime_connection_warm_up_meeting(ChimeConnection *cxn, ChimeMeeting *meeting,
+				      guint lead_minutes)
+{
+	g_return_if_fail(CHIME_IS_CONNECTION(cxn));
+	g_return_if_fail(CHIME_IS_MEETING(meeting));
+
+	if (meeting->warmed_up || meeting->warmup_timer || meeting->opens)
+		return;
+
+	GTimeVal start, now;
+	g_get_current_time(&now);
+	if (meeting->start_at && g_time_val_from_iso8601(meeting->start_at, &start) &&
+	    start.tv_sec - (glong)lead_minutes * 60 > now.tv_sec) {
+		meeting->warmup_timer = g_timeout_add_seconds(start.tv_sec - lead_minutes * 60 - now.tv_sec,
+							      do_warm_up_meeting, meeting);
+		return;
+	}
+
+	do_warm_up_meeting(meeting);
+}
+
 static void add_new_meeting_member(gpointer _contact, gpointer _jb)
 {
 	JsonBuilder **jb = _jb;
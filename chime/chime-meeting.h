@@ -60,6 +60,9 @@ ChimeMeeting *chime_connection_meeting_by_name(ChimeConnection *cxn,
 					 const gchar *name);
 ChimeMeeting *chime_connection_meeting_by_id(ChimeConnection *cxn,
 				       const gchar *id);
+ChimeMeeting *chime_connection_meeting_by_pin(ChimeConnection *cxn,
+					      const gchar *pin);
+guint chime_connection_joinable_meeting_count(ChimeConnection *cxn);
 
 /* Designed to match the NEW_MEETING signal handler */
 typedef void (*ChimeMeetingCB) (ChimeConnection *, ChimeMeeting *, gpointer);
@@ -141,6 +144,9 @@ ChimeMeeting *chime_connection_join_meeting_finish(ChimeConnection *self,
 						   GAsyncResult *result,
 						   GError **error);
 
+void chime_connection_warm_up_meeting(ChimeConnection *cxn, ChimeMeeting *meeting,
+				      guint lead_minutes);
+
 void chime_connection_create_meeting_async(ChimeConnection *cxn,
 					   GSList *contacts,
 					   gboolean bridge_locked,
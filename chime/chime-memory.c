@@ -0,0 +1,156 @@
+/*
+ * Pidgin/libpurple Chime client plugin
+ *
+ * Copyright © 2017 Amazon.com, Inc. or its affiliates.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "chime-connection-private.h"
+
+#include <glib/gi18n.h>
+
+/*
+ * Opt-in accounting of live objects and bytes by subsystem, for hunting
+ * down the slow growth in long-running sessions. It is enabled with
+ * CHIME_DEBUG=memory (it must be set from the start, or the frees of
+ * earlier allocations would drive the counts negative).
+ *
+ * The owners of each kind of object call chime_mem_account() when they
+ * create and destroy them; the byte counts cover the structure and any
+ * buffers it owns, but not strings or other objects it refers to.
+ *
+ * The counters are process-wide, since that's what actually grows.
+ */
+static const gchar *mem_tag_names[CHIME_MEM_LAST] = {
+	[CHIME_MEM_CONTACT] = "contacts",
+	[CHIME_MEM_ROOM] = "rooms",
+	[CHIME_MEM_ROOM_MEMBER] = "room members",
+	[CHIME_MEM_CONVERSATION] = "conversations",
+	[CHIME_MEM_MEETING] = "meetings",
+	[CHIME_MEM_CALL] = "calls",
+	[CHIME_MEM_CALL_PARTICIPANT] = "call participants",
+	[CHIME_MEM_HTTP_MSG] = "HTTP requests",
+	[CHIME_MEM_AUDIO_REASSEMBLY] = "audio data reassembly",
+	[CHIME_MEM_WEBSOCKET_QUEUE] = "websocket send queue",
+	[CHIME_MEM_MSG_GATHER] = "gathered messages",
+};
+
+struct mem_counts {
+	gssize objects;
+	gssize bytes;
+};
+
+static struct mem_counts mem_live[CHIME_MEM_LAST];
+
+/* For the growth columns of the report */
+static GMutex mem_report_lock;
+static struct mem_counts mem_last[CHIME_MEM_LAST];
+static gint64 mem_last_time;
+
+void chime_mem_account(ChimeMemTag tag, gssize bytes, gint objects)
+{
+	g_return_if_fail(tag < CHIME_MEM_LAST);
+
+	if (!chime_log_enabled(CHIME_LOG_MEMORY))
+		return;
+
+	/* Audio and screen sharing run in their own threads */
+	g_atomic_pointer_add(&mem_live[tag].objects, objects);
+	g_atomic_pointer_add(&mem_live[tag].bytes, bytes);
+}
+
+static gchar *format_delta(gssize d)
+{
+	return d ? g_strdup_printf("%+" G_GSSIZE_FORMAT, d) : g_strdup("");
+}
+
+/**
+ * chime_mem_report:
+ *
+ * Returns: (transfer full): a plain text table of the live objects and
+ * bytes for each subsystem, along with the change since the previous
+ * report. Since the counts start from zero, the first report shows the
+ * growth since startup.
+ */
+gchar *chime_mem_report(void)
+{
+	GString *out;
+	gint64 now = g_get_monotonic_time();
+	guint i;
+
+	chime_log_init();
+	if (!chime_log_enabled(CHIME_LOG_MEMORY))
+		return g_strdup(_("Memory accounting is disabled. Set CHIME_DEBUG=memory "
+				  "in the environment to enable it."));
+
+	out = g_string_new(NULL);
+
+	g_mutex_lock(&mem_report_lock);
+	if (!mem_last_time)
+		mem_last_time = now;
+
+	g_string_append_printf(out, "%-24s %9s %12s %10s %12s\n",
+			       "", "objects", "bytes", "Δobjects", "Δbytes");
+	for (i = 0; i < CHIME_MEM_LAST; i++) {
+		struct mem_counts cur;
+		gchar *dobj, *dbytes;
+
+		cur.objects = (gssize)g_atomic_pointer_get(&mem_live[i].objects);
+		cur.bytes = (gssize)g_atomic_pointer_get(&mem_live[i].bytes);
+
+		dobj = format_delta(cur.objects - mem_last[i].objects);
+		dbytes = format_delta(cur.bytes - mem_last[i].bytes);
+		g_string_append_printf(out, "%-24s %9" G_GSSIZE_FORMAT " %12" G_GSSIZE_FORMAT
+				       " %10s %12s\n", mem_tag_names[i],
+				       cur.objects, cur.bytes, dobj, dbytes);
+		g_free(dobj);
+		g_free(dbytes);
+
+		mem_last[i] = cur;
+	}
+	g_string_append_printf(out, _("\nChanges are since the previous report, %"
+				      G_GINT64_FORMAT "s ago.\n"),
+			       (now - mem_last_time) / G_USEC_PER_SEC);
+	mem_last_time = now;
+	g_mutex_unlock(&mem_report_lock);
+
+	return g_string_free(out, FALSE);
+}
+
+/**
+ * chime_mem_get_live:
+ * @tag: the subsystem
+ * @name: (out) (allow-none): its name, as in the report
+ * @objects: (out) (allow-none): the number of live objects
+ * @bytes: (out) (allow-none): the bytes they account for
+ *
+ * For tools which track the counts themselves. Unlike
+ * chime_mem_report(), this doesn't reset the report's baseline.
+ *
+ * Returns: %FALSE if memory accounting is disabled
+ */
+gboolean chime_mem_get_live(ChimeMemTag tag, const gchar **name,
+			    gssize *objects, gssize *bytes)
+{
+	g_return_val_if_fail(tag < CHIME_MEM_LAST, FALSE);
+
+	chime_log_init();
+	if (!chime_log_enabled(CHIME_LOG_MEMORY))
+		return FALSE;
+
+	if (name)
+		*name = mem_tag_names[tag];
+	if (objects)
+		*objects = (gssize)g_atomic_pointer_get(&mem_live[tag].objects);
+	if (bytes)
+		*bytes = (gssize)g_atomic_pointer_get(&mem_live[tag].bytes);
+	return TRUE;
+}
@@ -0,0 +1,159 @@
+/*
+ * Pidgin/libpurple Chime client plugin
+ *
+ * Copyright © 2017 Amazon.com, Inc. or its affiliates.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "chime-connection-private.h"
+
+#include <string.h>
+
+/*
+ * Deciding whether a message mentions us. This runs for every message in
+ * every room we're in, open or not, so it works on the raw Content and
+ * makes a single pass over it. A table of the bytes which can start a
+ * match (the '<' of a <@id|Name> mention, and the first letter of each
+ * keyword in either case) lets the scan skip everything else in a tight
+ * loop; only at those bytes do we look any closer.
+ */
+struct chime_mention_matcher {
+	guint8 starts[256];
+	gchar *self_id;
+	gsize self_len;
+	GPtrArray *keywords;	/* Word-boundary, ASCII case-insensitive */
+};
+
+void chime_mention_matcher_free(struct chime_mention_matcher *m)
+{
+	g_free(m->self_id);
+	g_ptr_array_unref(m->keywords);
+	g_free(m);
+}
+
+static struct chime_mention_matcher *build_matcher(ChimeConnectionPrivate *priv)
+{
+	struct chime_mention_matcher *m = g_new0(struct chime_mention_matcher, 1);
+	guint i;
+
+	m->self_id = g_strdup(priv->profile_id);
+	m->self_len = m->self_id ? strlen(m->self_id) : 0;
+	m->keywords = g_ptr_array_new_with_free_func(g_free);
+
+	m->starts[0] = 1;
+	m->starts['<'] = 1;
+
+	for (i = 0; priv->mention_keywords && priv->mention_keywords[i]; i++) {
+		gchar *kw = g_strstrip(g_strdup(priv->mention_keywords[i]));
+
+		if (!*kw) {
+			g_free(kw);
+			continue;
+		}
+		m->starts[(guchar)g_ascii_tolower(kw[0])] = 1;
+		m->starts[(guchar)g_ascii_toupper(kw[0])] = 1;
+		g_ptr_array_add(m->keywords, kw);
+	}
+
+	return m;
+}
+
+static gboolean is_word_byte(guchar c)
+{
+	return g_ascii_isalnum(c) || c == '_' || c >= 0x80;
+}
+
+/* After the "<@" of a mention */
+static gboolean mention_is_us(struct chime_mention_matcher *m, const gchar *id)
+{
+	if (!strncmp(id, "all|", 4) || !strncmp(id, "present|", 8))
+		return TRUE;
+
+	return m->self_len && !strncmp(id, m->self_id, m->self_len) &&
+		id[m->self_len] == '|';
+}
+
+static gboolean keyword_at(struct chime_mention_matcher *m, const guchar *start,
+			   const guchar *p)
+{
+	guint i;
+
+	if (p > start && is_word_byte(p[-1]))
+		return FALSE;
+
+	for (i = 0; i < m->keywords->len; i++) {
+		const gchar *kw = g_ptr_array_index(m->keywords, i);
+		gsize len = strlen(kw);
+
+		if (!g_ascii_strncasecmp((const gchar *)p, kw, len) &&
+		    !is_word_byte(p[len]))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * chime_connection_is_mentioned:
+ * @cxn: the connection
+ * @content: the raw Content of a message
+ *
+ * Returns: whether the message mentions us by profile, by @all or
+ * @present, or contains one of the configured keywords.
+ */
+gboolean chime_connection_is_mentioned(ChimeConnection *cxn, const gchar *content)
+{
+	g_return_val_if_fail(CHIME_IS_CONNECTION(cxn), FALSE);
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+	struct chime_mention_matcher *m = priv->mention_matcher;
+
+	if (!content)
+		return FALSE;
+
+	/* Our profile ID may not have been known when it was built */
+	if (!m || g_strcmp0(m->self_id, priv->profile_id)) {
+		if (m)
+			chime_mention_matcher_free(m);
+		m = priv->mention_matcher = build_matcher(priv);
+	}
+
+	const guchar *start = (const guchar *)content, *p = start;
+	for (;;) {
+		while (!m->starts[*p])
+			p++;
+		if (!*p)
+			return FALSE;
+
+		if (*p == '<' && p[1] == '@' && mention_is_us(m, (const gchar *)p + 2))
+			return TRUE;
+		if (m->keywords->len && keyword_at(m, start, p))
+			return TRUE;
+		p++;
+	}
+}
+
+/**
+ * chime_connection_set_mention_keywords:
+ * @cxn: the connection
+ * @keywords: (allow-none): comma-separated words which count as mentioning us
+ *
+ * Sets additional words which will be treated as mentions, as well as
+ * mentions of our own profile, @all and @present.
+ */
+void chime_connection_set_mention_keywords(ChimeConnection *cxn, const gchar *keywords)
+{
+	g_return_if_fail(CHIME_IS_CONNECTION(cxn));
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+
+	g_strfreev(priv->mention_keywords);
+	priv->mention_keywords = keywords ? g_strsplit(keywords, ",", -1) : NULL;
+
+	g_clear_pointer(&priv->mention_matcher, chime_mention_matcher_free);
+}
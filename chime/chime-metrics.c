@@ -0,0 +1,337 @@
+/*
+ * Pidgin/libpurple Chime client plugin
+ *
+ * Copyright © 2017 Amazon.com, Inc. or its affiliates.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "chime-connection-private.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#ifdef G_OS_UNIX
+#include <sys/stat.h>
+#include <gio/gunixsocketaddress.h>
+#endif
+
+/*
+ * Counters and histograms are fixed, and live in an array in the
+ * connection's private data indexed by the CHIME_METRIC_* enum, so
+ * updating one is just an add under a lock (some of the audio ones
+ * are updated from GStreamer threads). Gauges such as queue depths
+ * and collection sizes are read at the time the snapshot is taken.
+ *
+ * Histograms have power-of-two buckets of microseconds, which is
+ * plenty of resolution for telling a 20ms request from a 2s one and
+ * maps directly to Prometheus' cumulative "le" buckets.
+ */
+enum {
+	METRIC_COUNTER,
+	METRIC_HISTOGRAM,
+};
+
+static const struct {
+	const gchar *name;
+	const gchar *labels;
+	int type;
+	const gchar *help;
+} metric_defs[CHIME_METRIC_LAST] = {
+	[CHIME_METRIC_HTTP_REQUESTS] = { "chime_http_requests_total", NULL, METRIC_COUNTER,
+					 "HTTP requests completed" },
+	[CHIME_METRIC_HTTP_ERRORS] = { "chime_http_errors_total", NULL, METRIC_COUNTER,
+				       "HTTP requests which did not succeed" },
+	[CHIME_METRIC_HTTP_RENEWALS] = { "chime_http_token_renewals_total", NULL, METRIC_COUNTER,
+					 "Session token renewals after a 401" },
+	[CHIME_METRIC_HTTP_REFRESHES] = { "chime_http_token_refreshes_total", NULL, METRIC_COUNTER,
+					  "Session token renewals ahead of its expiry" },
+	[CHIME_METRIC_HTTP_DURATION] = { "chime_http_request_duration_seconds", NULL, METRIC_HISTOGRAM,
+					 "Time from queueing an HTTP request to its completion" },
+	[CHIME_METRIC_JUGG_MESSAGES] = { "chime_jugg_messages_total", NULL, METRIC_COUNTER,
+					 "Juggernaut messages received" },
+	[CHIME_METRIC_JUGG_UNHANDLED] = { "chime_jugg_unhandled_total", NULL, METRIC_COUNTER,
+					  "Juggernaut messages with no handler" },
+	[CHIME_METRIC_SYNC_CONTACTS] = { "chime_sync_duration_seconds", "collection=\"contacts\"",
+					 METRIC_HISTOGRAM, "Time taken to fetch a whole collection" },
+	[CHIME_METRIC_SYNC_ROOMS] = { "chime_sync_duration_seconds", "collection=\"rooms\"",
+				      METRIC_HISTOGRAM, NULL },
+	[CHIME_METRIC_SYNC_CONVERSATIONS] = { "chime_sync_duration_seconds", "collection=\"conversations\"",
+					      METRIC_HISTOGRAM, NULL },
+	[CHIME_METRIC_AUDIO_RX_PACKETS] = { "chime_audio_rx_packets_total", NULL, METRIC_COUNTER,
+					    "Audio transport packets received" },
+	[CHIME_METRIC_AUDIO_RX_DROPPED] = { "chime_audio_rx_dropped_total", NULL, METRIC_COUNTER,
+					    "Received audio frames with nowhere to go" },
+	[CHIME_METRIC_AUDIO_TX_PACKETS] = { "chime_audio_tx_packets_total", NULL, METRIC_COUNTER,
+					    "Audio RT packets sent" },
+};
+
+void chime_metric_add(ChimeConnection *cxn, guint metric, gint64 delta)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+
+	g_mutex_lock(&priv->metrics_lock);
+	priv->metrics[metric].sum += delta;
+	g_mutex_unlock(&priv->metrics_lock);
+}
+
+void chime_metric_observe(ChimeConnection *cxn, guint metric, gint64 usecs)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+	struct chime_metric *m = &priv->metrics[metric];
+	guint bucket = usecs <= 1 ? 0 : g_bit_storage(usecs - 1);
+
+	g_mutex_lock(&priv->metrics_lock);
+	m->count++;
+	m->sum += usecs;
+	if (usecs > m->max)
+		m->max = usecs;
+	if (bucket < CHIME_METRIC_BUCKETS)
+		m->buckets[bucket]++;
+	g_mutex_unlock(&priv->metrics_lock);
+}
+
+static void append_gauge(GString *out, const gchar *name, const gchar *labels,
+			 const gchar *help, gint64 val)
+{
+	if (help) {
+		g_string_append_printf(out, "# HELP %s %s\n", name, help);
+		g_string_append_printf(out, "# TYPE %s gauge\n", name);
+	}
+	g_string_append_printf(out, "%s%s%s%s %" G_GINT64_FORMAT "\n", name,
+			       labels ? "{" : "", labels ? labels : "", labels ? "}" : "", val);
+}
+
+static void append_histogram(GString *out, const gchar *name, const gchar *labels,
+			     const struct chime_metric *m)
+{
+	guint64 cumulative = 0;
+	gchar secs[G_ASCII_DTOSTR_BUF_SIZE];
+	int i;
+
+	for (i = 0; i < CHIME_METRIC_BUCKETS; i++) {
+		cumulative += m->buckets[i];
+		g_ascii_dtostr(secs, sizeof(secs), (gdouble)(1 << i) / G_USEC_PER_SEC);
+		g_string_append_printf(out, "%s_bucket{%s%sle=\"%s\"} %" G_GUINT64_FORMAT "\n",
+				       name, labels ? labels : "", labels ? "," : "",
+				       secs, cumulative);
+	}
+	g_string_append_printf(out, "%s_bucket{%s%sle=\"+Inf\"} %" G_GUINT64_FORMAT "\n",
+			       name, labels ? labels : "", labels ? "," : "", m->count);
+
+	g_ascii_dtostr(secs, sizeof(secs), (gdouble)m->sum / G_USEC_PER_SEC);
+	g_string_append_printf(out, "%s_sum%s%s%s %s\n", name,
+			       labels ? "{" : "", labels ? labels : "", labels ? "}" : "", secs);
+	g_string_append_printf(out, "%s_count%s%s%s %" G_GUINT64_FORMAT "\n", name,
+			       labels ? "{" : "", labels ? labels : "", labels ? "}" : "", m->count);
+}
+
+/**
+ * chime_connection_get_metrics:
+ *
+ * Returns: (transfer full): a snapshot of the connection's metrics in
+ * Prometheus text exposition format.
+ */
+gchar *chime_connection_get_metrics(ChimeConnection *cxn)
+{
+	g_return_val_if_fail(CHIME_IS_CONNECTION(cxn), NULL);
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+	struct chime_metric snap[CHIME_METRIC_LAST];
+	GString *out = g_string_new("");
+	int i;
+
+	g_mutex_lock(&priv->metrics_lock);
+	memcpy(snap, priv->metrics, sizeof(snap));
+	g_mutex_unlock(&priv->metrics_lock);
+
+	for (i = 0; i < CHIME_METRIC_LAST; i++) {
+		const gchar *name = metric_defs[i].name;
+
+		if (metric_defs[i].help) {
+			g_string_append_printf(out, "# HELP %s %s\n", name, metric_defs[i].help);
+			g_string_append_printf(out, "# TYPE %s %s\n", name,
+					       metric_defs[i].type == METRIC_COUNTER ?
+					       "counter" : "histogram");
+		}
+		if (metric_defs[i].type == METRIC_COUNTER)
+			g_string_append_printf(out, "%s %" G_GINT64_FORMAT "\n", name, snap[i].sum);
+		else
+			append_histogram(out, name, metric_defs[i].labels, &snap[i]);
+	}
+
+	append_gauge(out, "chime_http_queued", NULL, "HTTP requests in flight",
+		     priv->msgs_queued ? g_queue_get_length(priv->msgs_queued) : 0);
+	append_gauge(out, "chime_http_pending_auth", NULL,
+		     "HTTP requests waiting for a session token renewal",
+		     priv->msgs_pending_auth ? g_queue_get_length(priv->msgs_pending_auth) : 0);
+	append_gauge(out, "chime_jugg_subscriptions", NULL, "Juggernaut channels subscribed",
+		     priv->subscriptions ? g_hash_table_size(priv->subscriptions) : 0);
+
+	static const gchar objects_help[] = "Objects known in each collection";
+	append_gauge(out, "chime_objects", "collection=\"contacts\"", objects_help,
+		     priv->contacts.by_id ? g_hash_table_size(priv->contacts.by_id) : 0);
+	append_gauge(out, "chime_objects", "collection=\"rooms\"", NULL,
+		     priv->rooms.by_id ? g_hash_table_size(priv->rooms.by_id) : 0);
+	append_gauge(out, "chime_objects", "collection=\"conversations\"", NULL,
+		     priv->conversations.by_id ? g_hash_table_size(priv->conversations.by_id) : 0);
+	append_gauge(out, "chime_objects", "collection=\"meetings\"", NULL,
+		     priv->meetings.by_id ? g_hash_table_size(priv->meetings.by_id) : 0);
+	append_gauge(out, "chime_objects", "collection=\"calls\"", NULL,
+		     priv->calls.by_id ? g_hash_table_size(priv->calls.by_id) : 0);
+
+	static const gchar *online_names[CHIME_ONLINE_LAST] = {
+		[CHIME_ONLINE_JUGG] = "jugg",
+		[CHIME_ONLINE_CONTACTS] = "contacts",
+		[CHIME_ONLINE_ROOMS] = "rooms",
+		[CHIME_ONLINE_CONVERSATIONS] = "conversations",
+		[CHIME_ONLINE_MEETINGS] = "meetings",
+	};
+	g_string_append(out, "# HELP chime_online_seconds Time from connecting until each component was ready\n"
+			"# TYPE chime_online_seconds gauge\n");
+	for (i = 0; i < CHIME_ONLINE_LAST; i++) {
+		gchar secs[G_ASCII_DTOSTR_BUF_SIZE];
+
+		if (priv->online_time[i] < 0)
+			continue;
+		g_ascii_dtostr(secs, sizeof(secs), (gdouble)priv->online_time[i] / G_USEC_PER_SEC);
+		g_string_append_printf(out, "chime_online_seconds{component=\"%s\"} %s\n",
+				       online_names[i], secs);
+	}
+
+	chime_http_trace_append_metrics(cxn, out);
+	chime_watchdog_append_metrics(out);
+
+	return g_string_free(out, FALSE);
+}
+
+#ifdef G_OS_UNIX
+struct metrics_client {
+	ChimeConnection *cxn;
+	GSocketConnection *conn;
+	gchar reqbuf[1024];
+	gchar *response;
+};
+
+static void free_metrics_client(struct metrics_client *mc)
+{
+	g_io_stream_close(G_IO_STREAM(mc->conn), NULL, NULL);
+	g_object_unref(mc->conn);
+	g_object_unref(mc->cxn);
+	g_free(mc->response);
+	g_free(mc);
+}
+
+static void metrics_written(GObject *source, GAsyncResult *result, gpointer _mc)
+{
+	g_output_stream_write_all_finish(G_OUTPUT_STREAM(source), result, NULL, NULL);
+	free_metrics_client(_mc);
+}
+
+/* We don't care what was asked for; there's only one thing to serve.
+ * But do read the request first, so the client doesn't see a reset. */
+static void metrics_request_read(GObject *source, GAsyncResult *result, gpointer _mc)
+{
+	struct metrics_client *mc = _mc;
+	GError *error = NULL;
+
+	if (g_input_stream_read_finish(G_INPUT_STREAM(source), result, &error) < 0) {
+		g_error_free(error);
+		free_metrics_client(mc);
+		return;
+	}
+
+	gchar *metrics = chime_connection_get_metrics(mc->cxn);
+	mc->response = g_strdup_printf("HTTP/1.0 200 OK\r\n"
+				       "Content-Type: text/plain; version=0.0.4\r\n"
+				       "Content-Length: %zu\r\n\r\n%s",
+				       strlen(metrics), metrics);
+	g_free(metrics);
+
+	GOutputStream *os = g_io_stream_get_output_stream(G_IO_STREAM(mc->conn));
+	g_output_stream_write_all_async(os, mc->response, strlen(mc->response),
+					G_PRIORITY_LOW, NULL, metrics_written, mc);
+}
+
+static gboolean on_metrics_incoming(GSocketService *service, GSocketConnection *conn,
+				    GObject *source, gpointer _cxn)
+{
+	struct metrics_client *mc = g_new0(struct metrics_client, 1);
+
+	mc->cxn = g_object_ref(_cxn);
+	mc->conn = g_object_ref(conn);
+
+	GInputStream *is = g_io_stream_get_input_stream(G_IO_STREAM(conn));
+	g_input_stream_read_async(is, mc->reqbuf, sizeof(mc->reqbuf), G_PRIORITY_LOW,
+				  NULL, metrics_request_read, mc);
+	return TRUE;
+}
+#endif
+
+/**
+ * chime_connection_serve_metrics:
+ * @path: (nullable): filesystem path of the Unix socket, or %NULL to stop
+ *
+ * Serves chime_connection_get_metrics() over HTTP on a local Unix socket,
+ * for collection by something like `curl --unix-socket`.
+ */
+gboolean chime_connection_serve_metrics(ChimeConnection *cxn, const gchar *path,
+					GError **error)
+{
+	g_return_val_if_fail(CHIME_IS_CONNECTION(cxn), FALSE);
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+
+	if (priv->metrics_service) {
+		g_socket_service_stop(priv->metrics_service);
+		g_signal_handlers_disconnect_by_data(priv->metrics_service, cxn);
+		g_clear_object(&priv->metrics_service);
+		g_unlink(priv->metrics_path);
+		g_clear_pointer(&priv->metrics_path, g_free);
+	}
+
+	if (!path || !*path)
+		return TRUE;
+
+#ifdef G_OS_UNIX
+	/* A stale socket from a previous run would make the bind fail, but
+	 * don't remove anything else which happens to be at that path. */
+	GStatBuf st;
+	if (!g_lstat(path, &st)) {
+		if (!S_ISSOCK(st.st_mode)) {
+			g_set_error(error, G_IO_ERROR, G_IO_ERROR_EXISTS,
+				    "%s exists and is not a socket", path);
+			return FALSE;
+		}
+		g_unlink(path);
+	}
+
+	GSocketAddress *addr = g_unix_socket_address_new(path);
+	GSocketService *svc = g_socket_service_new();
+	gboolean ok = g_socket_listener_add_address(G_SOCKET_LISTENER(svc), addr,
+						    G_SOCKET_TYPE_STREAM,
+						    G_SOCKET_PROTOCOL_DEFAULT,
+						    NULL, NULL, error);
+	g_object_unref(addr);
+	if (!ok) {
+		g_object_unref(svc);
+		return FALSE;
+	}
+
+	g_signal_connect(svc, "incoming", G_CALLBACK(on_metrics_incoming), cxn);
+	g_socket_service_start(svc);
+
+	priv->metrics_service = svc;
+	priv->metrics_path = g_strdup(path);
+	return TRUE;
+#else
+	g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+		    "Unix sockets are not supported on this platform");
+	return FALSE;
+#endif
+}
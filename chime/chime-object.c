@@ -25,8 +25,8 @@
 typedef struct {
 	GObject parent_instance;
 
-	gchar *id;
-	gchar *name;
+	const gchar *id;	/* Both interned */
+	const gchar *name;
 
 	gint64 generation;
 
@@ -91,8 +91,8 @@ chime_object_finalize(GObject *object)
 
 	priv = chime_object_get_instance_private (self);
 
-	g_free(priv->id);
-	g_free(priv->name);
+	chime_unintern(priv->id);
+	chime_unintern(priv->name);
 
 	G_OBJECT_CLASS(chime_object_parent_class)->finalize(object);
 }
@@ -131,8 +131,7 @@ static void chime_object_set_property(GObject *object, guint prop_id,
 
 	switch (prop_id) {
 	case PROP_ID:
-		g_free(priv->id);
-		priv->id = g_value_dup_string(value);
+		chime_intern_replace(&priv->id, g_value_get_string(value));
 		break;
 	case PROP_NAME:
 		chime_object_rename(self, g_value_get_string(value));
@@ -160,11 +159,12 @@ void chime_object_rename(ChimeObject *self, const gchar *name)
 			g_hash_table_remove(priv->collection->by_name, priv->name);
 	}
 
-	g_free(priv->name);
-	priv->name = g_strdup(name);
+	chime_intern_replace(&priv->name, name);
 
 	if (priv->collection)
-		g_hash_table_insert(priv->collection->by_name, priv->name, self);
+		g_hash_table_insert(priv->collection->by_name, (gpointer)priv->name, self);
+
+	g_object_notify_by_pspec(G_OBJECT(self), props[PROP_NAME]);
 }
 
 static void chime_object_class_init(ChimeObjectClass *klass)
@@ -273,8 +273,8 @@ void chime_object_collection_hash_object(ChimeObjectCollection *collection, Chim
 
 	if (!priv->collection) {
 		priv->collection = collection;
-		g_hash_table_insert(collection->by_id, priv->id, object);
-		g_hash_table_insert(collection->by_name, priv->name, object);
+		g_hash_table_insert(collection->by_id, (gpointer)priv->id, object);
+		g_hash_table_insert(collection->by_name, (gpointer)priv->name, object);
 	}
 
 	if (live && priv->is_dead) {
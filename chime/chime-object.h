@@ -65,6 +65,11 @@ void chime_object_collection_foreach_object(ChimeConnection *cxn, ChimeObjectCol
 
 void chime_object_collection_expire_outdated(ChimeObjectCollection *coll);
 
+gboolean chime_connection_get_unread(ChimeConnection *cxn, ChimeObject *obj,
+				     guint *unread, guint *mentions);
+guint chime_connection_foreach_unread(ChimeConnection *cxn, guint limit,
+				      ChimeObjectCB cb, gpointer cbdata);
+
 void             chime_connection_send_message_async         (ChimeConnection    *self,
                                                               ChimeObject        *obj,
                                                               const gchar        *message,
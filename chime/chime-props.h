@@ -67,11 +67,13 @@
 	if (low && g_strcmp0(low, CHIME_PROP_OBJ_VAR->low)) {		\
 		g_free(CHIME_PROP_OBJ_VAR->low);			\
 		CHIME_PROP_OBJ_VAR->low = g_strdup(low);		\
-		g_object_notify(G_OBJECT(CHIME_PROP_OBJ_VAR), name);	\
+		g_object_notify_by_pspec(G_OBJECT(CHIME_PROP_OBJ_VAR),	\
+					 props[PROP_##up]);		\
 	}
 #define _chime_prop_update_bool(low, up, json, name, nick, req)	\
 	if (low != CHIME_PROP_OBJ_VAR->low) {				\
 		CHIME_PROP_OBJ_VAR->low = low;				\
-		g_object_notify(G_OBJECT(CHIME_PROP_OBJ_VAR), name);	\
+		g_object_notify_by_pspec(G_OBJECT(CHIME_PROP_OBJ_VAR),	\
+					 props[PROP_##up]);		\
 	}
 #define CHIME_PROPS_UPDATE STRING_PROPS(_chime_prop_update_str) BOOL_PROPS(_chime_prop_update_bool)
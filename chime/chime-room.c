@@ -79,6 +79,10 @@ struct _ChimeRoom {
 	ChimeConnection *cxn;
 	GHashTable *members;
 	gboolean members_done[2];
+
+	/* For the room directory */
+	gchar *dir_key;
+	gboolean in_dir;
 };
 
 G_DEFINE_TYPE(ChimeRoom, chime_room, CHIME_TYPE_OBJECT)
@@ -114,9 +118,13 @@ chime_room_finalize(GObject *object)
 
 	CHIME_PROPS_FREE
 
+	g_free(self->dir_key);
+
 	if (self->members)
 		g_hash_table_destroy(self->members);
 
+	chime_mem_account(CHIME_MEM_ROOM, -(gssize)sizeof(*self), -1);
+
 	G_OBJECT_CLASS(chime_room_parent_class)->finalize(object);
 }
 
@@ -261,6 +269,7 @@ static void chime_room_class_init(ChimeRoomClass *klass)
 
 static void chime_room_init(ChimeRoom *self)
 {
+	chime_mem_account(CHIME_MEM_ROOM, sizeof(*self), 1);
 }
 
 const gchar *chime_room_get_id(ChimeRoom *self)
@@ -339,6 +348,142 @@ static gboolean parse_room_type(JsonNode *node, const gchar *member, ChimeRoomTy
 	return TRUE;
 }
 
+/*
+ * The room directory is an array of the live rooms, kept sorted by their
+ * case-folded names (and then IDs, since names aren't unique). It is
+ * maintained as rooms come, go and are renamed, so that the room list can
+ * be paged through, and searched by name prefix, without visiting and
+ * sorting every room each time. It holds no references; rooms are removed
+ * as soon as they die, before the collection drops its own reference.
+ */
+static gint room_dir_cmp(ChimeRoom *a, const gchar *key, const gchar *id)
+{
+	gint ret = strcmp(a->dir_key, key);
+	if (!ret)
+		ret = strcmp(chime_room_get_id(a), id);
+	return ret;
+}
+
+/* The index of the first room not ordered before (key, id) */
+static guint room_dir_bsearch(GPtrArray *dir, const gchar *key, const gchar *id)
+{
+	guint lo = 0, hi = dir->len;
+
+	while (lo < hi) {
+		guint mid = (lo + hi) / 2;
+
+		if (room_dir_cmp(g_ptr_array_index(dir, mid), key, id) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static void room_dir_add(ChimeConnectionPrivate *priv, ChimeRoom *room)
+{
+	const gchar *id = chime_room_get_id(room);
+
+	if (room->in_dir)
+		return;
+
+	if (!room->dir_key)
+		room->dir_key = g_utf8_casefold(chime_room_get_name(room), -1);
+
+	g_ptr_array_insert(priv->room_dir,
+			   room_dir_bsearch(priv->room_dir, room->dir_key, id),
+			   room);
+	room->in_dir = TRUE;
+}
+
+static void room_dir_remove(ChimeConnectionPrivate *priv, ChimeRoom *room)
+{
+	if (!room->in_dir)
+		return;
+
+	guint i = room_dir_bsearch(priv->room_dir, room->dir_key, chime_room_get_id(room));
+	if (i < priv->room_dir->len && g_ptr_array_index(priv->room_dir, i) == room)
+		g_ptr_array_remove_index(priv->room_dir, i);
+	else
+		g_ptr_array_remove(priv->room_dir, room);
+	room->in_dir = FALSE;
+}
+
+static void room_dir_rename(ChimeConnectionPrivate *priv, ChimeRoom *room)
+{
+	gboolean was_in_dir = room->in_dir;
+
+	room_dir_remove(priv, room);
+	g_clear_pointer(&room->dir_key, g_free);
+	if (was_in_dir)
+		room_dir_add(priv, room);
+}
+
+static void on_room_dead(ChimeRoom *room, GParamSpec *ignored, ChimeConnection *cxn)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE(cxn);
+
+	if (chime_object_is_dead(CHIME_OBJECT(room)))
+		room_dir_remove(priv, room);
+	else
+		room_dir_add(priv, room);
+}
+
+/**
+ * chime_connection_search_rooms:
+ * @cxn: the connection
+ * @prefix: (allow-none): case-insensitive prefix of the room names to match
+ * @offset: the index of the first match to return
+ * @limit: the maximum number of matches to return, or zero for all
+ * @cb: callback for each room
+ * @cbdata: data for @cb
+ *
+ * Invokes @cb for a page of the live rooms whose names start with @prefix,
+ * in order of name.
+ *
+ * Returns: the total number of matching rooms
+ */
+guint chime_connection_search_rooms(ChimeConnection *cxn, const gchar *prefix,
+				    guint offset, guint limit,
+				    ChimeRoomCB cb, gpointer cbdata)
+{
+	g_return_val_if_fail(CHIME_IS_CONNECTION(cxn), 0);
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE(cxn);
+	GPtrArray *dir = priv->room_dir;
+	guint start = 0, end, i;
+
+	if (!dir)
+		return 0;
+
+	end = dir->len;
+	if (prefix && *prefix) {
+		gchar *key = g_utf8_casefold(prefix, -1);
+		gsize len = strlen(key);
+
+		/* The matches are a contiguous range; find its start... */
+		start = room_dir_bsearch(dir, key, "");
+
+		/* ... and its end */
+		guint lo = start, hi = dir->len;
+		while (lo < hi) {
+			guint mid = (lo + hi) / 2;
+			ChimeRoom *room = g_ptr_array_index(dir, mid);
+
+			if (!strncmp(room->dir_key, key, len))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		end = lo;
+		g_free(key);
+	}
+
+	for (i = start + offset; cb && i < end && (!limit || i < start + offset + limit); i++)
+		cb(cxn, g_ptr_array_index(dir, i), cbdata);
+
+	return end - start;
+}
+
 static ChimeRoom *chime_connection_parse_room(ChimeConnection *cxn, JsonNode *node,
 					      GError **error)
 {
@@ -389,46 +534,59 @@ static ChimeRoom *chime_connection_parse_room(ChimeConnection *cxn, JsonNode *no
 
 		chime_object_collection_hash_object(&priv->rooms, CHIME_OBJECT(room), TRUE);
 
+		room_dir_add(priv, room);
+		g_signal_connect(room, "notify::dead", G_CALLBACK(on_room_dead), cxn);
+		chime_activity_update(cxn, CHIME_OBJECT(room), room->last_sent,
+				      room->last_read, room->last_mentioned);
+
 		/* Emit signal on ChimeConnection to admit existence of new room */
 		chime_connection_new_room(cxn, room);
 
 		return room;
 	}
 
+	/* Emit the notifications together, once the room is consistent */
+	g_object_freeze_notify(G_OBJECT(room));
+
 	if (name && g_strcmp0(name, chime_object_get_name(CHIME_OBJECT(room)))) {
 		chime_object_rename(CHIME_OBJECT(room), name);
-		g_object_notify(G_OBJECT(room), "name");
+		room_dir_rename(priv, room);
 	}
 	if (privacy != room->privacy) {
 		room->privacy = privacy;
-		g_object_notify(G_OBJECT(room), "privacy");
+		g_object_notify_by_pspec(G_OBJECT(room), props[PROP_PRIVACY]);
 	}
 	if (type != room->type) {
 		room->type = type;
-		g_object_notify(G_OBJECT(room), "type");
+		g_object_notify_by_pspec(G_OBJECT(room), props[PROP_TYPE]);
 	}
 	if (visibility != room->visibility) {
 		room->visibility = visibility;
-		g_object_notify(G_OBJECT(room), "visibility");
+		g_object_notify_by_pspec(G_OBJECT(room), props[PROP_VISIBILITY]);
 	}
 
 	CHIME_PROPS_UPDATE
 
 	if (desktop != room->desktop_notification) {
 		room->desktop_notification = desktop;
-		g_object_notify(G_OBJECT(room), "desktop-notification-prefs");
+		g_object_notify_by_pspec(G_OBJECT(room), props[PROP_DESKTOP_NOTIFICATION_PREFS]);
 	}
 	if (mobile != room->mobile_notification) {
 		room->mobile_notification = mobile;
-		g_object_notify(G_OBJECT(room), "mobile-notification-prefs");
+		g_object_notify_by_pspec(G_OBJECT(room), props[PROP_MOBILE_NOTIFICATION_PREFS]);
 	}
 
+	g_object_thaw_notify(G_OBJECT(room));
+
 	chime_object_collection_hash_object(&priv->rooms, CHIME_OBJECT(room), TRUE);
+	chime_activity_update(cxn, CHIME_OBJECT(room), room->last_sent,
+			      room->last_read, room->last_mentioned);
 
 	return room;
 }
 
 static void fetch_rooms(ChimeConnection *cxn, const gchar *next_token);
+static void resolve_pending_rooms(ChimeConnection *cxn, gboolean sync_done);
 
 static void rooms_cb(ChimeConnection *cxn, SoupMessage *msg, JsonNode *node,
 			gpointer _unused)
@@ -460,12 +618,16 @@ static void rooms_cb(ChimeConnection *cxn, SoupMessage *msg, JsonNode *node,
 		}
 
 		const gchar *next_token;
-		if (parse_string(node, "NextToken", &next_token))
+		if (parse_string(node, "NextToken", &next_token)) {
+			resolve_pending_rooms(cxn, FALSE);
 			fetch_rooms(cxn, next_token);
-		else {
+		} else {
 			priv->rooms_sync = CHIME_SYNC_IDLE;
+			chime_metric_observe(cxn, CHIME_METRIC_SYNC_ROOMS,
+					     g_get_monotonic_time() - priv->rooms_sync_start);
 
 			chime_object_collection_expire_outdated(&priv->rooms);
+			resolve_pending_rooms(cxn, TRUE);
 
 			if (!priv->rooms_online) {
 				priv->rooms_online = TRUE;
@@ -500,6 +662,7 @@ static void fetch_rooms(ChimeConnection *cxn, const gchar *next_token)
 		case CHIME_SYNC_IDLE:
 			priv->rooms.generation++;
 			priv->rooms_sync = CHIME_SYNC_FETCHING;
+			priv->rooms_sync_start = g_get_monotonic_time();
 		}
 	}
 
@@ -533,18 +696,139 @@ static gboolean room_msg_jugg_cb(ChimeConnection *cxn, gpointer _room, JsonNode
 	return TRUE;
 }
 
+/*
+ * It seems they don't do the helpful thing and send the notification of
+ * a new room before they send the first message. So messages for rooms
+ * we don't know yet are queued here by RoomId, while we go looking for
+ * the room. There is only one fetch for each room however many messages
+ * arrive meanwhile, and none at all if a sync of the rooms list is
+ * already running (which it will be, since we get VisibleRooms first);
+ * we wait to see whether that finds it. Once the room is known the
+ * queued messages are replayed in the order they arrived.
+ */
+struct pending_room {
+	GQueue nodes;		/* Of JsonNode */
+	gboolean fetching;
+};
+
+static void free_pending_room(gpointer _pending)
+{
+	struct pending_room *pending = _pending;
+	JsonNode *node;
+
+	while ((node = g_queue_pop_head(&pending->nodes)))
+		json_node_unref(node);
+	g_free(pending);
+}
+
 static gboolean demux_room_msg_jugg_cb(ChimeConnection *cxn, gpointer _room, JsonNode *data_node);
-static void demux_fetch_room_done(GObject *source, GAsyncResult *result, gpointer user_data)
+
+static void replay_pending_room(ChimeConnection *cxn, ChimeRoom *room,
+				struct pending_room *pending)
 {
-	ChimeConnection *cxn = CHIME_CONNECTION(source);
-	ChimeRoom *room = chime_connection_fetch_room_finish(cxn, result, NULL);
+	JsonNode *node;
 
-	if (user_data) {
-		/* Sanity check that demux_room_msg_jugg_cb() *will* be able to look it up... */
+	while ((node = g_queue_pop_head(&pending->nodes))) {
 		if (room)
-			demux_room_msg_jugg_cb(cxn, room, user_data);
+			demux_room_msg_jugg_cb(cxn, room, node);
+		json_node_unref(node);
+	}
+	free_pending_room(pending);
+}
+
+static void pending_room_fetched(GObject *source, GAsyncResult *result, gpointer _room_id)
+{
+	ChimeConnection *cxn = CHIME_CONNECTION(source);
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+	gchar *room_id = _room_id;
+	GError *error = NULL;
+	ChimeRoom *room = chime_connection_fetch_room_finish(cxn, result, &error);
+
+	if (!room) {
+		chime_debug("Failed to fetch room %s: %s\n", room_id, error->message);
+		g_error_free(error);
+	}
+
+	struct pending_room *pending = NULL;
+	if (priv->pending_rooms) {
+		pending = g_hash_table_lookup(priv->pending_rooms, room_id);
+		if (pending)
+			g_hash_table_steal(priv->pending_rooms, room_id);
+	}
+	if (pending)
+		replay_pending_room(cxn, room, pending);
+
+	if (room)
+		g_object_unref(room);
+	g_free(room_id);
+}
+
+static void fetch_pending_room(ChimeConnection *cxn, const gchar *room_id,
+			       struct pending_room *pending)
+{
+	pending->fetching = TRUE;
+	chime_connection_fetch_room_async(cxn, room_id, NULL, pending_room_fetched,
+					  g_strdup(room_id));
+}
 
-		json_node_unref(user_data);
+/* Queue a message (if any) behind the lookup of an unknown room */
+static void queue_pending_room(ChimeConnection *cxn, const gchar *room_id,
+			       JsonNode *data_node)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+	struct pending_room *pending = g_hash_table_lookup(priv->pending_rooms, room_id);
+
+	if (!pending) {
+		pending = g_new0(struct pending_room, 1);
+		g_queue_init(&pending->nodes);
+		g_hash_table_insert(priv->pending_rooms, g_strdup(room_id), pending);
+	}
+	if (data_node)
+		g_queue_push_tail(&pending->nodes, json_node_ref(data_node));
+
+	if (!pending->fetching && priv->rooms_sync == CHIME_SYNC_IDLE)
+		fetch_pending_room(cxn, room_id, pending);
+}
+
+/* After each page of a rooms sync, replay the messages for any rooms it
+ * found. At the end, go and fetch the ones it didn't. */
+static void resolve_pending_rooms(ChimeConnection *cxn, gboolean sync_done)
+{
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+	GHashTableIter iter;
+	gpointer room_id, _pending;
+	GSList *found = NULL;
+
+	if (!priv->pending_rooms)
+		return;
+
+	g_hash_table_iter_init(&iter, priv->pending_rooms);
+	while (g_hash_table_iter_next(&iter, &room_id, &_pending)) {
+		struct pending_room *pending = _pending;
+		ChimeRoom *room;
+
+		if (pending->fetching)
+			continue;
+
+		room = chime_connection_room_by_id(cxn, room_id);
+		if (room) {
+			/* Replay after the walk; it may queue more */
+			found = g_slist_prepend(found, g_object_ref(room));
+			found = g_slist_prepend(found, pending);
+			g_hash_table_iter_steal(&iter);
+			g_free(room_id);
+		} else if (sync_done)
+			fetch_pending_room(cxn, room_id, pending);
+	}
+
+	while (found) {
+		struct pending_room *pending = found->data;
+		ChimeRoom *room = found->next->data;
+
+		replay_pending_room(cxn, room, pending);
+		g_object_unref(room);
+		found = g_slist_delete_link(found, found);
+		found = g_slist_delete_link(found, found);
 	}
 }
 
@@ -560,20 +844,32 @@ static gboolean demux_room_msg_jugg_cb(ChimeConnection *cxn, gpointer _room, Jso
 		return FALSE;
 
 	ChimeRoom *room = _room;
-	if (!room)
-		room = chime_connection_room_by_id(cxn, room_id);
 	if (!room) {
-		/* It seems they don't do the helpful thing and send the notification
-		 * of a new room before they send the first message. So let's go
-		 * looking for it... */
-		/* XXX: We *do* get VisibleRooms first though, and could avoid this
-		 * query if that one is already running... */
-		chime_connection_fetch_room_async(cxn, room_id, NULL, demux_fetch_room_done, json_node_ref(data_node));
-		return TRUE;
+		ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+
+		/* Stay in order behind any which are already waiting */
+		if (!g_hash_table_contains(priv->pending_rooms, room_id))
+			room = chime_connection_room_by_id(cxn, room_id);
+		if (!room) {
+			queue_pending_room(cxn, room_id, data_node);
+			return TRUE;
+		}
 	}
+
+	const gchar *content;
+	gboolean mentioned = parse_string(record, "Content", &content) &&
+		chime_connection_is_mentioned(cxn, content);
+
+	chime_activity_message(cxn, CHIME_OBJECT(room), record, mentioned);
+
 	if (room->opens)
 		return room_msg_jugg_cb(cxn, room, data_node);
 
+	/* Most of these don't concern us; don't bother anyone with them,
+	 * unless the room is set to notify about every message. */
+	if (!mentioned && room->desktop_notification != CHIME_NOTIFY_PREF_ALWAYS)
+		return TRUE;
+
 	g_signal_emit_by_name(cxn, "room-mention", room, record);
 	return TRUE;
 }
@@ -599,15 +895,26 @@ static gboolean room_jugg_cb(ChimeConnection *cxn, gpointer _unused, JsonNode *d
 	if (!parse_string(record_node, "RoomId", &room_id))
 		return FALSE;
 
-	chime_connection_fetch_room_async(cxn, room_id, NULL, demux_fetch_room_done, NULL);
+	queue_pending_room(cxn, room_id, NULL);
 	return TRUE;
 }
 
+static void unwatch_room(gpointer key, gpointer val, gpointer cxn)
+{
+	ChimeRoom *room = CHIME_ROOM(val);
+
+	room->in_dir = FALSE;
+	g_signal_handlers_disconnect_by_func(room, on_room_dead, cxn);
+}
+
 void chime_init_rooms(ChimeConnection *cxn)
 {
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
 
 	chime_object_collection_init(cxn, &priv->rooms);
+	priv->room_dir = g_ptr_array_new();
+	priv->pending_rooms = g_hash_table_new_full(g_str_hash, g_str_equal,
+						    g_free, free_pending_room);
 
 	chime_jugg_subscribe(cxn, priv->profile_channel, "VisibleRooms",
 			     visible_rooms_jugg_cb, NULL);
@@ -633,8 +940,12 @@ void chime_destroy_rooms(ChimeConnection *cxn)
 	chime_jugg_unsubscribe(cxn, priv->device_channel, "RoomMessage",
 			       demux_room_msg_jugg_cb, NULL);
 
-	if (priv->rooms.by_id)
+	if (priv->rooms.by_id) {
+		g_hash_table_foreach(priv->rooms.by_id, unwatch_room, cxn);
 		g_hash_table_foreach(priv->rooms.by_id, close_room, NULL);
+	}
+	g_clear_pointer(&priv->room_dir, g_ptr_array_unref);
+	g_clear_pointer(&priv->pending_rooms, g_hash_table_destroy);
 
 	chime_object_collection_destroy(&priv->rooms);
 }
@@ -678,6 +989,8 @@ static void free_member(gpointer _member)
 	g_free(member->last_read);
 	g_free(member->last_delivered);
 	g_free(member);
+
+	chime_mem_account(CHIME_MEM_ROOM_MEMBER, -(gssize)sizeof(*member), -1);
 }
 
 static gboolean add_room_member(ChimeConnection *cxn, ChimeRoom *room, JsonNode *node)
@@ -694,6 +1007,7 @@ static gboolean add_room_member(ChimeConnection *cxn, ChimeRoom *room, JsonNode
 	ChimeRoomMember *member = g_hash_table_lookup(room->members, chime_contact_get_profile_id(contact));
 	if (!member) {
 		member = g_new0(ChimeRoomMember, 1);
+		chime_mem_account(CHIME_MEM_ROOM_MEMBER, sizeof(*member), 1);
 		member->contact = contact;
 		g_hash_table_insert(room->members, (void *)chime_contact_get_profile_id(contact), member);
 	} else {
@@ -60,6 +60,9 @@ ChimeRoom *chime_connection_room_by_id(ChimeConnection *cxn,
 typedef void (*ChimeRoomCB) (ChimeConnection *, ChimeRoom *, gpointer);
 void chime_connection_foreach_room(ChimeConnection *cxn, ChimeRoomCB cb,
 				   gpointer cbdata);
+guint chime_connection_search_rooms(ChimeConnection *cxn, const gchar *prefix,
+				    guint offset, guint limit,
+				    ChimeRoomCB cb, gpointer cbdata);
 
 typedef struct {
 	ChimeContact *contact;
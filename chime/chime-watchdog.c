@@ -0,0 +1,196 @@
+/*
+ * Pidgin/libpurple Chime client plugin
+ *
+ * Copyright © 2017 Amazon.com, Inc. or its affiliates.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "chime-connection-private.h"
+
+/*
+ * Main loop latency watchdog, enabled with CHIME_DEBUG=latency.
+ *
+ * A high-priority timer on the default context notices when it fires
+ * late, which means that something hogged the main loop. To say *what*,
+ * the main entry points into libchime (HTTP completion, juggernaut
+ * messages, audio packets) are bracketed with chime_scope_enter() and
+ * chime_scope_exit(), which time themselves. A scope which runs for
+ * longer than the threshold is counted against its name, and the worst
+ * of them is named when the timer reports the stall. Time lost outside
+ * any scope is counted as "(outside libchime)".
+ *
+ * Only scopes on the thread running the main loop are counted, and the
+ * markers cost nothing but a branch when the watchdog is disabled.
+ */
+#define WATCHDOG_TICK_MS 20
+#define STALL_THRESHOLD_US (50 * 1000)
+#define OUTSIDE_SCOPE "(outside libchime)"
+
+struct stall_stats {
+	guint64 count;
+	gint64 total;		/* µs */
+	gint64 max;		/* µs */
+};
+
+static GThread *watchdog_thread;
+static guint watchdog_users;
+static guint watchdog_src;
+static gint64 watchdog_expected;
+static struct chime_scope *current_scope;
+
+/* The longest stalling scope since the last tick */
+static const gchar *worst_name;
+static gchar *worst_detail;
+static gint64 worst_time;
+
+static GMutex stalls_lock;	/* The metrics may be served from another thread */
+static GHashTable *stalls;	/* Scope name → struct stall_stats */
+
+static void record_stall(const gchar *name, gint64 duration)
+{
+	struct stall_stats *st;
+
+	g_mutex_lock(&stalls_lock);
+	if (!stalls)
+		stalls = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+
+	st = g_hash_table_lookup(stalls, name);
+	if (!st) {
+		st = g_new0(struct stall_stats, 1);
+		g_hash_table_insert(stalls, (gpointer)name, st);
+	}
+	st->count++;
+	st->total += duration;
+	if (duration > st->max)
+		st->max = duration;
+	g_mutex_unlock(&stalls_lock);
+}
+
+void chime_scope_enter(struct chime_scope *scope, const gchar *name, const gchar *detail)
+{
+	if (!watchdog_src || g_thread_self() != watchdog_thread) {
+		scope->start = 0;
+		return;
+	}
+
+	scope->name = name;
+	scope->detail = detail;
+	scope->inner_stalled = FALSE;
+	scope->outer = current_scope;
+	scope->start = g_get_monotonic_time();
+	current_scope = scope;
+}
+
+void chime_scope_exit(struct chime_scope *scope)
+{
+	if (!scope->start)
+		return;
+
+	gint64 duration = g_get_monotonic_time() - scope->start;
+	current_scope = scope->outer;
+
+	if (duration < STALL_THRESHOLD_US)
+		return;
+
+	/* Blame the innermost scope which was slow, not all its callers */
+	if (scope->outer)
+		scope->outer->inner_stalled = TRUE;
+	if (scope->inner_stalled)
+		return;
+
+	record_stall(scope->name, duration);
+	if (duration > worst_time) {
+		worst_name = scope->name;
+		worst_time = duration;
+		g_free(worst_detail);
+		worst_detail = g_strdup(scope->detail);
+	}
+}
+
+static gboolean watchdog_tick(gpointer _unused)
+{
+	gint64 now = g_get_monotonic_time();
+	gint64 late = now - watchdog_expected;
+
+	if (late >= STALL_THRESHOLD_US) {
+		if (!worst_name)
+			record_stall(OUTSIDE_SCOPE, late);
+
+		chime_debug_cat(CHIME_LOG_LATENCY,
+				"Main loop stalled for %" G_GINT64_FORMAT "ms; %s%s%s (%" G_GINT64_FORMAT "ms)\n",
+				late / 1000, worst_name ? worst_name : OUTSIDE_SCOPE,
+				worst_detail ? " " : "", worst_detail ? worst_detail : "",
+				(worst_name ? worst_time : late) / 1000);
+	}
+
+	worst_name = NULL;
+	worst_time = 0;
+	g_clear_pointer(&worst_detail, g_free);
+
+	watchdog_expected = now + WATCHDOG_TICK_MS * 1000;
+	return G_SOURCE_CONTINUE;
+}
+
+/* Returns TRUE if the caller must balance it with chime_watchdog_stop() */
+gboolean chime_watchdog_start(void)
+{
+	chime_log_init();
+	if (!chime_log_enabled(CHIME_LOG_LATENCY))
+		return FALSE;
+
+	if (watchdog_users++)
+		return TRUE;
+
+	GSource *src = g_timeout_source_new(WATCHDOG_TICK_MS);
+	g_source_set_priority(src, G_PRIORITY_HIGH);
+	g_source_set_callback(src, watchdog_tick, NULL, NULL);
+	watchdog_src = g_source_attach(src, NULL);
+	g_source_unref(src);
+
+	watchdog_thread = g_thread_self();
+	watchdog_expected = g_get_monotonic_time() + WATCHDOG_TICK_MS * 1000;
+	return TRUE;
+}
+
+void chime_watchdog_stop(void)
+{
+	if (!watchdog_users || --watchdog_users)
+		return;
+
+	g_source_remove(watchdog_src);
+	watchdog_src = 0;
+	current_scope = NULL;
+}
+
+void chime_watchdog_append_metrics(GString *out)
+{
+	GHashTableIter iter;
+	gpointer name, _st;
+
+	g_mutex_lock(&stalls_lock);
+	if (stalls) {
+		g_hash_table_iter_init(&iter, stalls);
+		while (g_hash_table_iter_next(&iter, &name, &_st)) {
+			struct stall_stats *st = _st;
+			gchar secs[G_ASCII_DTOSTR_BUF_SIZE];
+
+			g_string_append_printf(out, "chime_mainloop_stalls_total{scope=\"%s\"} %" G_GUINT64_FORMAT "\n",
+					       (gchar *)name, st->count);
+			g_ascii_dtostr(secs, sizeof(secs), (gdouble)st->total / G_USEC_PER_SEC);
+			g_string_append_printf(out, "chime_mainloop_stall_seconds_sum{scope=\"%s\"} %s\n",
+					       (gchar *)name, secs);
+			g_ascii_dtostr(secs, sizeof(secs), (gdouble)st->max / G_USEC_PER_SEC);
+			g_string_append_printf(out, "chime_mainloop_stall_seconds_max{scope=\"%s\"} %s\n",
+					       (gchar *)name, secs);
+		}
+	}
+	g_mutex_unlock(&stalls_lock);
+}
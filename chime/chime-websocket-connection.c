@@ -24,6 +24,7 @@
 
 #include <libsoup/soup.h>
 #include "chime-websocket-connection.h"
+#include "chime-connection.h"
 
 /*
  * SECTION:websocketconnection
@@ -156,6 +157,8 @@ frame_free (gpointer data)
 	Frame *frame = data;
 
 	if (frame) {
+		chime_mem_account (CHIME_MEM_WEBSOCKET_QUEUE,
+				   -(gssize)(sizeof (Frame) + g_bytes_get_size (frame->data)), -1);
 		g_bytes_unref (frame->data);
 		g_slice_free (Frame, frame);
 	}
@@ -1013,6 +1016,7 @@ queue_frame (ChimeWebsocketConnection *self,
 
 	frame = g_slice_new0 (Frame);
 	frame->data = g_bytes_new_take (data, len);
+	chime_mem_account (CHIME_MEM_WEBSOCKET_QUEUE, sizeof (Frame) + len, 1);
 	frame->amount = amount;
 	frame->last = (flags & CHIME_WEBSOCKET_QUEUE_LAST) ? TRUE : FALSE;
 
@@ -25,6 +25,11 @@ static void
 websocket_connect_async_complete (SoupSession *session, SoupMessage *msg, gpointer user_data)
 {
 	GTask *task = G_TASK(user_data);
+	ChimeConnection *cxn = CHIME_CONNECTION(g_task_get_task_data (task));
+	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
+
+	if (priv->ws_connect_msg == msg)
+		priv->ws_connect_msg = NULL;
 
 	/* Disconnect websocket_connect_async_stop() handler. */
 	g_signal_handlers_disconnect_matched (msg, G_SIGNAL_MATCH_DATA,
@@ -45,6 +50,9 @@ websocket_connect_async_stop (SoupMessage *msg, gpointer user_data)
 	ChimeConnectionPrivate *priv = CHIME_CONNECTION_GET_PRIVATE (cxn);
 	GError *error = NULL;
 
+	if (priv->ws_connect_msg == msg)
+		priv->ws_connect_msg = NULL;
+
 	/* Disconnect websocket_connect_async_stop() handler. */
 	g_signal_handlers_disconnect_matched (msg, G_SIGNAL_MATCH_DATA,
 					      0, 0, NULL, NULL, task);
@@ -121,6 +129,9 @@ chime_connection_websocket_connect_async (ChimeConnection      *cxn,
 	soup_message_add_status_code_handler (msg, "got-informational",
 					      SOUP_STATUS_SWITCHING_PROTOCOLS,
 					      G_CALLBACK (websocket_connect_async_stop), task);
+
+	/* So that a connection on a shared session can cancel just its own */
+	priv->ws_connect_msg = msg;
 	soup_session_queue_message(priv->soup_sess, msg, websocket_connect_async_complete, task);
 }
 
@@ -16,14 +16,41 @@
  */
 
 #include <errno.h>
+#include <unistd.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <debug.h>
 #include "chime.h"
 
+#ifdef HAVE_GDK_PIXBUF
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#endif
+
 // According to http://docs.aws.amazon.com/chime/latest/ug/chime-ug.pdf this is the maximum allowed size for attachments.
 // (The default limit for purple_util_fetch_url() is 512 kB.)
 #define ATTACHMENT_MAX_SIZE (50*1000*1000)
 
+/* Inline previews of image attachments are scaled to fit in this box */
+#define THUMBNAIL_SIZE 320
+
+/*
+ * Downloads are stored once under downloads/.by-hash/<sha256> and the
+ * per-message <msgid>-<filename> is a hardlink to that, so the same file
+ * posted to many rooms only takes up space once. Thumbnails are keyed by
+ * the same hash under downloads/.thumbs/<sha256>.png.
+ *
+ * The hash isn't known until the file has been fetched, and each message
+ * has its own URL, so this saves disk space but not bandwidth. Only the
+ * same attachment of the same message is fetched just once.
+ */
+#define CACHE_DIR ".by-hash"
+#define THUMBS_DIR ".thumbs"
+
+/* Paths currently being fetched, each with a list of DownloadCallbackData
+ * waiting for it. Backfill and live delivery of the same message can both
+ * ask for an attachment before the first fetch completes. */
+static GHashTable *downloads_in_flight;
+
 /*
  * Writes to the IM conversation handling the case where the user sent message
  * from other client.
@@ -49,10 +76,15 @@ static void write_conversation_message(const char *from, const char *im_email,
 	}
 }
 
-static void img_message(AttachmentContext *ctx, int image_id)
+static void img_message(AttachmentContext *ctx, int image_id, const gchar *link)
 {
 	PurpleMessageFlags flags = PURPLE_MESSAGE_IMAGES;
-	gchar *msg = g_strdup_printf("<br><img id=\"%u\">", image_id);
+	gchar *msg;
+
+	if (link)
+		msg = g_strdup_printf("<br><a href=\"file://%s\"><img id=\"%u\"></a>", link, image_id);
+	else
+		msg = g_strdup_printf("<br><img id=\"%u\">", image_id);
 	if (ctx->chat_id != -1) {
 		serv_got_chat_in(ctx->conn, ctx->chat_id, ctx->from, flags, msg, ctx->when);
 	} else {
@@ -71,7 +103,7 @@ static void sys_message(AttachmentContext *ctx, const gchar *msg, PurpleMessageF
 	}
 }
 
-static void insert_image_from_file(AttachmentContext *ctx, const gchar *path)
+static void insert_image_from_file(AttachmentContext *ctx, const gchar *path, const gchar *link)
 {
 	gchar *contents;
 	gsize size;
@@ -91,12 +123,13 @@ static void insert_image_from_file(AttachmentContext *ctx, const gchar *path)
 		g_free(msg);
 		return;
 	}
-	img_message(ctx, img_id);
+	img_message(ctx, img_id, link);
 }
 
 typedef struct _DownloadCallbackData {
 	ChimeAttachment *att;
 	AttachmentContext *ctx;
+	gchar *dir;
 	gchar *path;
 } DownloadCallbackData;
 
@@ -108,45 +141,174 @@ static void deep_free_download_data(DownloadCallbackData *data)
 	g_free(data->att->content_type);
 	g_free(data->att);
 	g_free(data->ctx);
+	g_free(data->dir);
 	g_free(data->path);
 	g_free(data);
 }
 
-static void download_callback(PurpleUtilFetchUrlData *url_data, gpointer user_data, const gchar *url_text, gsize len, const gchar *error_message)
+static void link_message(DownloadCallbackData *data)
 {
-	DownloadCallbackData *data = user_data;
+	gchar *msg = g_strdup_printf(_("%s has attached <a href=\"file://%s\">%s</a>"), data->ctx->from, data->path, data->att->filename);
+	sys_message(data->ctx, msg, PURPLE_MESSAGE_SYSTEM);
+	g_free(msg);
+}
 
-	if (error_message != NULL) {
-		sys_message(data->ctx, error_message, PURPLE_MESSAGE_ERROR);
-		deep_free_download_data(data);
+#ifdef HAVE_GDK_PIXBUF
+/* Runs in a worker thread; only touches the filesystem, never libpurple. */
+static void make_thumbnail(GTask *task, gpointer source, gpointer task_data,
+			   GCancellable *cancellable)
+{
+	DownloadCallbackData *data = task_data;
+	GError *err = NULL;
+	gchar *contents;
+	gsize len;
+
+	if (!g_file_get_contents(data->path, &contents, &len, &err)) {
+		g_task_return_error(task, err);
 		return;
 	}
+	gchar *sum = g_compute_checksum_for_data(G_CHECKSUM_SHA256, (const guchar *)contents, len);
+	g_free(contents);
 
-	if (len <= 0 || url_text == NULL ){
-		sys_message(data->ctx, _("Downloaded empty contents."), PURPLE_MESSAGE_ERROR);
-		deep_free_download_data(data);
+	gchar *thumbs_dir = g_build_filename(data->dir, THUMBS_DIR, NULL);
+	gchar *thumb_name = g_strdup_printf("%s.png", sum);
+	gchar *thumb = g_build_filename(thumbs_dir, thumb_name, NULL);
+	g_free(thumb_name);
+	g_free(sum);
+
+	if (!g_file_test(thumb, G_FILE_TEST_IS_REGULAR)) {
+		GdkPixbuf *pb = gdk_pixbuf_new_from_file_at_scale(data->path, THUMBNAIL_SIZE,
+								  THUMBNAIL_SIZE, TRUE, &err);
+		if (!pb || g_mkdir_with_parents(thumbs_dir, 0755) == -1 ||
+		    !gdk_pixbuf_save(pb, thumb, "png", &err, NULL)) {
+			if (err)
+				g_task_return_error(task, err);
+			else
+				g_task_return_new_error(task, G_FILE_ERROR, g_file_error_from_errno(errno),
+							_("Could not make dir %s"), thumbs_dir);
+			if (pb)
+				g_object_unref(pb);
+			g_free(thumbs_dir);
+			g_free(thumb);
+			return;
+		}
+		g_object_unref(pb);
+	}
+	g_free(thumbs_dir);
+
+	g_task_return_pointer(task, thumb, g_free);
+}
+
+static void thumbnail_done(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	DownloadCallbackData *data = g_task_get_task_data(G_TASK(result));
+	gchar *thumb = g_task_propagate_pointer(G_TASK(result), NULL);
+
+	if (!PURPLE_CONNECTION_IS_VALID(data->ctx->conn)) {
+		g_free(thumb);
 		return;
 	}
 
-	GError *err = NULL;
-	if (!g_file_set_contents(data->path, url_text, len, &err)) {
-		sys_message(data->ctx, err->message, PURPLE_MESSAGE_ERROR);
-		g_error_free(err);
+	/* If we couldn't scale it, fall back to showing the original. */
+	if (thumb)
+		insert_image_from_file(data->ctx, thumb, data->path);
+	else
+		insert_image_from_file(data->ctx, data->path, NULL);
+
+	g_free(thumb);
+}
+#endif /* HAVE_GDK_PIXBUF */
+
+/* Show an attachment which is now present on disk at data->path. Takes ownership of data. */
+static void deliver_attachment(DownloadCallbackData *data)
+{
+	if (!g_content_type_is_a(data->att->content_type, "image/*")) {
+		link_message(data);
 		deep_free_download_data(data);
 		return;
 	}
+#ifdef HAVE_GDK_PIXBUF
+	GTask *task = g_task_new(NULL, NULL, thumbnail_done, NULL);
+	g_task_set_task_data(task, data, (GDestroyNotify)deep_free_download_data);
+	g_task_run_in_thread(task, make_thumbnail);
+	g_object_unref(task);
+#else
+	insert_image_from_file(data->ctx, data->path, NULL);
+	deep_free_download_data(data);
+#endif
+}
 
-	if (g_content_type_is_a(data->att->content_type, "image/*")) {
-		insert_image_from_file(data->ctx, data->path);
-	} else {
-		gchar *msg = g_strdup_printf(_("%s has attached <a href=\"file://%s\">%s</a>"), data->ctx->from, data->path, data->att->filename);
-		sys_message(data->ctx, msg, PURPLE_MESSAGE_SYSTEM);
-		g_free(msg);
+/*
+ * Store the downloaded contents under their SHA256 in the cache directory,
+ * and make the per-message filename a link to that. If the same file was
+ * already downloaded for another message, we just add another link.
+ */
+static gboolean store_attachment(DownloadCallbackData *data, const gchar *contents,
+				 gsize len, GError **err)
+{
+	gboolean linked = FALSE;
+#ifndef _WIN32
+	gchar *sum = g_compute_checksum_for_data(G_CHECKSUM_SHA256, (const guchar *)contents, len);
+	gchar *cache_dir = g_build_filename(data->dir, CACHE_DIR, NULL);
+	gchar *cache_path = g_build_filename(cache_dir, sum, NULL);
+
+	if (g_mkdir_with_parents(cache_dir, 0755) != -1 &&
+	    (g_file_test(cache_path, G_FILE_TEST_IS_REGULAR) ||
+	     g_file_set_contents(cache_path, contents, len, NULL))) {
+		g_unlink(data->path);
+		linked = !link(cache_path, data->path);
+		if (!linked)
+			purple_debug_warning("chime", "Failed to link %s to %s: %s\n",
+					     data->path, cache_path, g_strerror(errno));
 	}
 
+	g_free(cache_path);
+	g_free(cache_dir);
+	g_free(sum);
+#endif
+	/* Fall back to a private copy if the filesystem won't do hardlinks */
+	return linked || g_file_set_contents(data->path, contents, len, err);
+}
+
+/* Tell each conversation waiting for the file that it isn't coming */
+static void download_failed(gpointer _data, gpointer msg)
+{
+	DownloadCallbackData *data = _data;
+
+	sys_message(data->ctx, msg, PURPLE_MESSAGE_ERROR);
 	deep_free_download_data(data);
 }
 
+static void download_callback(PurpleUtilFetchUrlData *url_data, gpointer user_data, const gchar *url_text, gsize len, const gchar *error_message)
+{
+	DownloadCallbackData *data = user_data;
+	GSList *waiters = NULL;
+	gpointer orig_key;
+	GError *err = NULL;
+
+	/* Everyone else who asked for the same file while we were fetching it */
+	if (g_hash_table_lookup_extended(downloads_in_flight, data->path, &orig_key, (gpointer *)&waiters)) {
+		g_hash_table_steal(downloads_in_flight, data->path);
+		g_free(orig_key);
+	}
+	waiters = g_slist_prepend(waiters, data);
+
+	if (error_message == NULL) {
+		if (len <= 0 || url_text == NULL)
+			error_message = _("Downloaded empty contents.");
+		else if (!store_attachment(data, url_text, len, &err))
+			error_message = err->message;
+	}
+
+	if (error_message != NULL)
+		g_slist_foreach(waiters, download_failed, (gpointer)error_message);
+	else
+		g_slist_foreach(waiters, (GFunc)deliver_attachment, NULL);
+
+	g_slist_free(waiters);
+	g_clear_error(&err);
+}
+
 ChimeAttachment *extract_attachment(JsonNode *record)
 {
 	JsonObject *robj;
@@ -187,8 +349,27 @@ void download_attachment(ChimeConnection *cxn, ChimeAttachment *att, AttachmentC
 	}
 	DownloadCallbackData *data = g_new0(DownloadCallbackData, 1);
 	data->path = g_strdup_printf("%s/%s-%s", dir, att->message_id, att->filename);
-	g_free(dir);
+	data->dir = dir;
 	data->att = att;
 	data->ctx = ctx;
+
+	/* Already fetched, perhaps on a previous backfill of this room */
+	if (g_file_test(data->path, G_FILE_TEST_IS_REGULAR)) {
+		purple_debug_misc("chime", "Attachment %s already downloaded\n", data->path);
+		deliver_attachment(data);
+		return;
+	}
+
+	if (!downloads_in_flight)
+		downloads_in_flight = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	GSList *waiters;
+	if (g_hash_table_lookup_extended(downloads_in_flight, data->path, NULL, (gpointer *)&waiters)) {
+		waiters = g_slist_append(waiters, data);
+		g_hash_table_replace(downloads_in_flight, g_strdup(data->path), waiters);
+		return;
+	}
+
+	g_hash_table_insert(downloads_in_flight, g_strdup(data->path), NULL);
 	purple_util_fetch_url_len(att->url, TRUE, NULL, FALSE, ATTACHMENT_MAX_SIZE, download_callback, data);
 }
@@ -60,62 +60,166 @@ static void on_contact_disposed(ChimeContact *contact, PurpleConnection *conn)
 }
 
 
-static void on_buddystatus_changed(ChimeContact *contact, GParamSpec *ignored, PurpleConnection *conn)
+/*
+ * Reconciliation of the buddy list against the server's contacts list is
+ * batched. Changes to contacts are queued, and applied together from an
+ * idle callback so that a whole page of a contacts sync (or the full set,
+ * when we first connect) is handled in one pass. That pass builds a single
+ * table of the existing buddies by e-mail address instead of searching the
+ * blist for each contact, and avoids poking the blist (which triggers a
+ * save and a UI update each time) for aliases and statuses which haven't
+ * actually changed.
+ */
+struct buddy_map {
+	PurpleConnection *conn;
+	GHashTable *by_email;	/* email → GSList of PurpleBuddy */
+};
+
+static void buddy_map_init(struct buddy_map *map, PurpleConnection *conn)
+{
+	GSList *l = purple_find_buddies(conn->account, NULL);
+
+	map->conn = conn;
+	map->by_email = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					      (GDestroyNotify)g_slist_free);
+	while (l) {
+		PurpleBuddy *buddy = l->data;
+		const gchar *email = purple_buddy_get_name(buddy);
+		GSList *list = g_hash_table_lookup(map->by_email, email);
+
+		/* Insert after the head, so the table's value stays valid */
+		if (list)
+			list->next = g_slist_prepend(list->next, buddy);
+		else
+			g_hash_table_insert(map->by_email, g_strdup(email),
+					    g_slist_prepend(NULL, buddy));
+		l = g_slist_delete_link(l, l);
+	}
+}
+
+static void update_buddy_status(PurpleConnection *conn, GSList *buddies,
+				ChimeContact *contact)
 {
-	gboolean is_buddy;
-	const gchar *email;
-	ChimeAvailability availability;
+	ChimeAvailability availability = chime_contact_get_availability(contact);
+	if (!availability || !buddies)
+		return;
+
+	/* Statuses are per-account, so checking one buddy is enough */
+	const gchar *name = chime_availability_name(availability);
+	PurpleStatus *status = purple_presence_get_active_status(purple_buddy_get_presence(buddies->data));
+	if (!status || strcmp(purple_status_get_id(status), name))
+		purple_prpl_got_user_status(conn->account, chime_contact_get_email(contact),
+					    name, NULL);
+}
 
-	email = chime_contact_get_email(contact);
-	availability = chime_contact_get_availability(contact);
-	is_buddy = chime_contact_get_contacts_list(contact);
+/* Returns TRUE if the contact's buddies were handled and can be forgotten */
+static gboolean sync_contact(struct buddy_map *map, ChimeContact *contact,
+			     gboolean may_remove)
+{
+	PurpleConnection *conn = map->conn;
+	const gchar *email = chime_contact_get_email(contact);
+	GSList *buddies = g_hash_table_lookup(map->by_email, email);
+	GSList *l;
 
-	if (!is_buddy) {
+	if (!chime_contact_get_contacts_list(contact)) {
 		/* Don't remove from blist until we're fully connected because
 		 * some contacts may appear first from conversations and only
 		 * later from the contacts list. We don't want to delete them
 		 * here only to add them back to the default "Chime Contacts"
 		 * group later. */
-		if (PURPLE_CONNECTION_IS_CONNECTED(conn)) {
-			GSList *buddies = purple_find_buddies(conn->account, email);
-			while (buddies) {
-				if (PURPLE_BLIST_NODE_SHOULD_SAVE(buddies->data))
-					purple_blist_remove_buddy(buddies->data);
-				buddies = g_slist_remove(buddies, buddies->data);
-			}
+		if (!may_remove || !PURPLE_CONNECTION_IS_CONNECTED(conn)) {
+			/* Refresh status for transient buddies on reconnect */
+			update_buddy_status(conn, buddies, contact);
+			return FALSE;
 		}
-	} else {
-		const gchar *display_name = chime_contact_get_display_name(contact);
-
-		gboolean found = FALSE;
-		GSList *buddies = purple_find_buddies(conn->account, email);
-		while (buddies) {
-			PurpleBuddy *buddy = buddies->data;
-			if (PURPLE_BLIST_NODE_SHOULD_SAVE(buddy))
-				found = TRUE;
-			purple_blist_server_alias_buddy(buddy, display_name);
-			buddies = g_slist_remove(buddies, buddy);
+
+		for (l = buddies; l; l = l->next) {
+			if (PURPLE_BLIST_NODE_SHOULD_SAVE(l->data))
+				purple_blist_remove_buddy(l->data);
 		}
-		/* If this is a known contact on the server and we didn't find it
-		   in Pidgin except as a transient one, add it now. */
-		if (!found) {
-			PurpleGroup *group = purple_find_group(_("Chime Contacts"));
-			if (!group) {
-				group = purple_group_new(_("Chime Contacts"));
-				purple_blist_add_group(group, NULL);
-			}
-			PurpleBuddy *buddy = purple_buddy_new(conn->account, email, NULL);
+		return TRUE;
+	}
+
+	const gchar *display_name = chime_contact_get_display_name(contact);
+	gboolean found = FALSE;
+
+	for (l = buddies; l; l = l->next) {
+		PurpleBuddy *buddy = l->data;
+
+		if (PURPLE_BLIST_NODE_SHOULD_SAVE(buddy))
+			found = TRUE;
+		if (g_strcmp0(purple_buddy_get_server_alias(buddy), display_name))
 			purple_blist_server_alias_buddy(buddy, display_name);
-			purple_blist_add_buddy(buddy, NULL, group, NULL);
+	}
+	/* If this is a known contact on the server and we didn't find it
+	   in Pidgin except as a transient one, add it now. */
+	if (!found) {
+		PurpleGroup *group = purple_find_group(_("Chime Contacts"));
+		if (!group) {
+			group = purple_group_new(_("Chime Contacts"));
+			purple_blist_add_group(group, NULL);
 		}
+		PurpleBuddy *buddy = purple_buddy_new(conn->account, email, NULL);
+		purple_blist_server_alias_buddy(buddy, display_name);
+		purple_blist_add_buddy(buddy, NULL, group, NULL);
+
+		buddies = g_slist_prepend(g_slist_copy(buddies), buddy);
+		update_buddy_status(conn, buddies, contact);
+		g_slist_free(buddies);
+	} else
+		update_buddy_status(conn, buddies, contact);
+
+	return TRUE;
+}
+
+static gboolean sync_pending_buddies(gpointer _conn)
+{
+	PurpleConnection *conn = _conn;
+	struct purple_chime *pc = purple_connection_get_protocol_data(conn);
+	struct buddy_map map;
+	GHashTableIter iter;
+	gpointer contact, may_remove;
+
+	pc->buddy_sync_id = 0;
 
-		if (availability)
-			purple_prpl_got_user_status(conn->account, email,
-						    chime_availability_name(availability), NULL);
+	buddy_map_init(&map, conn);
+
+	g_hash_table_iter_init(&iter, pc->buddy_sync_pending);
+	while (g_hash_table_iter_next(&iter, &contact, &may_remove)) {
+		if (sync_contact(&map, contact, GPOINTER_TO_INT(may_remove)))
+			g_hash_table_remove(map.by_email, chime_contact_get_email(contact));
+		g_hash_table_iter_remove(&iter);
 	}
+
+	g_hash_table_destroy(map.by_email);
+	return FALSE;
 }
 
-void on_chime_new_contact(ChimeConnection *cxn, ChimeContact *contact, PurpleConnection *conn)
+static void queue_buddy_sync(PurpleConnection *conn, ChimeContact *contact,
+			     gboolean may_remove)
+{
+	struct purple_chime *pc = purple_connection_get_protocol_data(conn);
+
+	if (!pc->buddy_sync_pending)
+		pc->buddy_sync_pending = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+							       g_object_unref, NULL);
+
+	if (g_hash_table_lookup(pc->buddy_sync_pending, contact))
+		may_remove = TRUE;
+
+	g_hash_table_replace(pc->buddy_sync_pending, g_object_ref(contact),
+			     GINT_TO_POINTER(may_remove));
+
+	if (!pc->buddy_sync_id)
+		pc->buddy_sync_id = g_idle_add(sync_pending_buddies, conn);
+}
+
+static void on_buddystatus_changed(ChimeContact *contact, GParamSpec *ignored, PurpleConnection *conn)
+{
+	queue_buddy_sync(conn, contact, TRUE);
+}
+
+static void watch_contact(PurpleConnection *conn, ChimeContact *contact)
 {
 	g_signal_handlers_disconnect_matched(contact, G_SIGNAL_MATCH_FUNC|G_SIGNAL_MATCH_DATA,
 					     0, 0, NULL, on_buddystatus_changed, conn);
@@ -134,16 +238,67 @@ void on_chime_new_contact(ChimeConnection *cxn, ChimeContact *contact, PurpleCon
 			 G_CALLBACK(on_contact_display_name), conn);
 	g_signal_connect(contact, "disposed",
 			 G_CALLBACK(on_contact_disposed), conn);
+}
 
-	/* Refresh status for transient buddies on reconnect */
-	if (purple_find_buddy(conn->account, chime_contact_get_email(contact)))
-		on_contact_availability(contact, NULL, conn);
+void on_chime_new_contact(ChimeConnection *cxn, ChimeContact *contact, PurpleConnection *conn)
+{
+	watch_contact(conn, contact);
+	queue_buddy_sync(conn, contact, FALSE);
+}
+
+static void sync_contact_cb(ChimeConnection *cxn, ChimeContact *contact, gpointer _map)
+{
+	struct buddy_map *map = _map;
+
+	watch_contact(map->conn, contact);
+	if (sync_contact(map, contact, FALSE))
+		g_hash_table_remove(map->by_email, chime_contact_get_email(contact));
+}
+
+/* The full reconciliation when we first connect and have all the contacts */
+void chime_purple_sync_buddies(PurpleConnection *conn)
+{
+	struct purple_chime *pc = purple_connection_get_protocol_data(conn);
+	struct buddy_map map;
+	GHashTableIter iter;
+	gpointer buddies;
+
+	/* This covers anything which was pending */
+	if (pc->buddy_sync_id) {
+		g_source_remove(pc->buddy_sync_id);
+		pc->buddy_sync_id = 0;
+	}
+	if (pc->buddy_sync_pending)
+		g_hash_table_remove_all(pc->buddy_sync_pending);
+
+	buddy_map_init(&map, conn);
+
+	/* Add any that exist, and monitor status for all */
+	chime_connection_foreach_contact(pc->cxn, sync_contact_cb, &map);
+
+	/* What remains are buddies which aren't on the contacts list */
+	g_hash_table_iter_init(&iter, map.by_email);
+	while (g_hash_table_iter_next(&iter, NULL, &buddies)) {
+		GSList *l;
 
-	/* When invoked for all contacts on the CONNECTED signal, we don't immediately
-	   get the above signal invoked because they're not actually *new* contacts.
-	   So run it manually. */
-	if (chime_contact_get_contacts_list(contact))
-		on_buddystatus_changed(contact, NULL, conn);
+		for (l = buddies; l; l = l->next) {
+			if (PURPLE_BLIST_NODE_SHOULD_SAVE(l->data))
+				purple_blist_remove_buddy(l->data);
+		}
+	}
+
+	g_hash_table_destroy(map.by_email);
+}
+
+void purple_chime_destroy_buddies(PurpleConnection *conn)
+{
+	struct purple_chime *pc = purple_connection_get_protocol_data(conn);
+
+	if (pc->buddy_sync_id) {
+		g_source_remove(pc->buddy_sync_id);
+		pc->buddy_sync_id = 0;
+	}
+	g_clear_pointer(&pc->buddy_sync_pending, g_hash_table_destroy);
 }
 
 void chime_purple_buddy_free(PurpleBuddy *buddy)
@@ -241,14 +396,12 @@ static void search_im(PurpleConnection *conn, GList *row, gpointer _unused)
 
 struct search_data {
 	PurpleConnection *conn;
-	void *ui_handle;
+	struct chime_sr *sr;
 	GSList *contacts;
-	guint refresh_id;
 };
 
-static PurpleNotifySearchResults *generate_search_results(GSList *contacts)
+static void search_columns(PurpleNotifySearchResults *results)
 {
-	PurpleNotifySearchResults *results = purple_notify_searchresults_new();
 	PurpleNotifySearchColumn *column;
 
 	column = purple_notify_searchresults_column_new(_("Name"));
@@ -262,30 +415,33 @@ static PurpleNotifySearchResults *generate_search_results(GSList *contacts)
 					       search_add_buddy);
 	purple_notify_searchresults_button_add(results, PURPLE_NOTIFY_BUTTON_IM,
 					       search_im);
+}
+
+static void search_rows(struct chime_sr *sr, gpointer _sd)
+{
+	struct search_data *sd = _sd;
+	GSList *contacts = sd->contacts;
 
 	gpointer klass = g_type_class_ref(CHIME_TYPE_AVAILABILITY);
 
 	while (contacts) {
 		ChimeContact *contact = contacts->data;
-		GList *row = NULL;
-		row = g_list_append(row, g_strdup(chime_contact_get_display_name(contact)));
-		row = g_list_append(row, g_strdup(chime_contact_get_email(contact)));
 		GEnumValue *val = g_enum_get_value(klass, chime_contact_get_availability(contact));
-		row = g_list_append(row, g_strdup(_(val->value_nick)));
-		purple_notify_searchresults_row_add(results, row);
+		const gchar *row[] = { chime_contact_get_display_name(contact),
+				       chime_contact_get_email(contact),
+				       _(val->value_nick) };
+		chime_sr_add_row(sr, row, G_N_ELEMENTS(row));
 		contacts = contacts->next;
 	}
 
 	g_type_class_unref(klass);
-	return results;
 }
 
 static void search_closed_cb(gpointer _sd)
 {
 	struct search_data *sd = _sd;
 
-	if (sd->refresh_id)
-		g_source_remove(sd->refresh_id);
+	chime_sr_free(sd->sr);
 	while (sd->contacts) {
 		ChimeContact *contact = sd->contacts->data;
 		g_signal_handlers_disconnect_matched(contact, G_SIGNAL_MATCH_DATA,
@@ -296,22 +452,9 @@ static void search_closed_cb(gpointer _sd)
 	g_free(sd);
 }
 
-static gboolean renew_search_results(gpointer _sd)
-{
-	struct search_data *sd = _sd;
-
-	PurpleNotifySearchResults *results = generate_search_results(sd->contacts);
-	purple_notify_searchresults_new_rows(sd->conn, results, sd->ui_handle);
-
-	sd->refresh_id = 0;
-	return FALSE;
-}
-
 static void on_search_availability(ChimeContact *contact, GParamSpec *ignored, struct search_data *sd)
 {
-	/* Gather them up to avoid repeatedly redrawing as they come in the first time */
-	if (!sd->refresh_id)
-		sd->refresh_id = g_idle_add(renew_search_results, sd);
+	chime_sr_refresh(sd->sr);
 }
 
 static void search_done(GObject *source, GAsyncResult *result, gpointer _conn)
@@ -326,14 +469,12 @@ static void search_done(GObject *source, GAsyncResult *result, gpointer _conn)
 		return;
 	}
 
-	PurpleNotifySearchResults *results = generate_search_results(contacts);
-
 	struct search_data *sd = g_new0(struct search_data, 1);
 	sd->contacts = contacts;
 	sd->conn = conn;
-	sd->ui_handle = purple_notify_searchresults(conn, _("Chime autocomplete"), _("Search results"),
-						    NULL, results, search_closed_cb, sd);
-	if (!sd->ui_handle) {
+	sd->sr = chime_sr_new(conn, search_columns, search_rows, sd);
+	if (!chime_sr_show(sd->sr, _("Chime autocomplete"), _("Search results"),
+			   NULL, search_closed_cb, sd)) {
 		purple_notify_error(conn, NULL,
 				    _("Unable to display search results."),
 				    NULL);
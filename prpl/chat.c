@@ -59,7 +59,8 @@ struct chime_chat {
 	PurpleConversation *conv;
 	ChimeMeeting *meeting;
 	ChimeCall *call;
-	void *participants_ui;
+	struct chime_sr *participants_sr;
+	GHashTable *participants;	/* Owned by the ChimeCall */
 	PurpleMedia *media;
 	gboolean media_connected;
 
@@ -82,15 +83,10 @@ struct chime_chat {
 #define MENTION_PATTERN "&lt;@([\\w\\-]+)\\|(.*?)&gt;"
 #define MENTION_REPLACEMENT "<b>\\2</b>"
 
-/*
- * Returns whether `me` was mentioned in the Chime `message`, and allocates a
- * new string in `*parsed`.
- */
-static int parse_inbound_mentions(ChimeConnection *cxn, GRegex *mention_regex, const char *message, char **parsed)
+/* Allocates a new string with the mentions in the Chime `message` made readable */
+static gchar *parse_inbound_mentions(GRegex *mention_regex, const char *message)
 {
-	*parsed = g_regex_replace(mention_regex, message, -1, 0, MENTION_REPLACEMENT, 0, NULL);
-	return strstr(message, chime_connection_get_profile_id(cxn)) || strstr(message, "&lt;@all|") ||
-		strstr(message, "&lt;@present|");
+	return g_regex_replace(mention_regex, message, -1, 0, MENTION_REPLACEMENT, 0, NULL);
 }
 
 static void replace(gchar **dst, const gchar *pattern, const gchar *replacement)
@@ -167,8 +163,9 @@ static void do_chat_deliver_msg(ChimeConnection *cxn, struct chime_msgs *msgs,
 
 	gchar *parsed = NULL;
 	if (CHIME_IS_ROOM(chat->m.obj)) {
-		if (parse_inbound_mentions(cxn, pc->mention_regex, escaped, &parsed) &&
-		    (msg_flags & PURPLE_MESSAGE_RECV)) {
+		parsed = parse_inbound_mentions(pc->mention_regex, escaped);
+		if ((msg_flags & PURPLE_MESSAGE_RECV) &&
+		    chime_connection_is_mentioned(cxn, content)) {
 			// Presumably this will trigger a notification.
 			msg_flags |= PURPLE_MESSAGE_NICK;
 		}
@@ -233,9 +230,8 @@ static void open_participant_im(PurpleConnection *conn, GList *row, gpointer _ch
 	}
 }
 
-static PurpleNotifySearchResults *generate_sr_participants(GHashTable *participants)
+static void participants_columns(PurpleNotifySearchResults *results)
 {
-	PurpleNotifySearchResults *results = purple_notify_searchresults_new();
 	PurpleNotifySearchColumn *column;
 
 	column = purple_notify_searchresults_column_new(_("Name"));
@@ -248,17 +244,22 @@ static PurpleNotifySearchResults *generate_sr_participants(GHashTable *participa
 	purple_notify_searchresults_column_add(results, column);
 
 	purple_notify_searchresults_button_add(results, PURPLE_NOTIFY_BUTTON_IM, open_participant_im);
+}
+
+static void participants_rows(struct chime_sr *sr, gpointer _chat)
+{
+	struct chime_chat *chat = _chat;
+
+	if (!chat->participants)
+		return;
 
 	gpointer klass = g_type_class_ref(CHIME_TYPE_CALL_PARTICIPATION_STATUS);
 
-	GList *pl = g_hash_table_get_values(participants);
+	GList *pl = g_hash_table_get_values(chat->participants);
 	pl = g_list_sort(pl, participant_sort);
 	while (pl) {
 		ChimeCallParticipant *p = pl->data;
-		GList *row = NULL;
-		row = g_list_append(row, g_strdup(p->full_name));
 		GEnumValue *val = g_enum_get_value(klass, p->status);
-		row = g_list_append(row, g_strdup(_(val->value_nick)));
 
 		const gchar *screen_icon;
 		if (p->shared_screen == CHIME_SHARED_SCREEN_VIEWING)
@@ -267,7 +268,6 @@ static PurpleNotifySearchResults *generate_sr_participants(GHashTable *participa
 			screen_icon = "🗔";
 		else
 			screen_icon = "";
-		row = g_list_append(row, g_strdup(screen_icon));
 
 		const gchar *vol_icon;
 		if (p->status != CHIME_PARTICIPATION_PRESENT)
@@ -280,23 +280,22 @@ static PurpleNotifySearchResults *generate_sr_participants(GHashTable *participa
 			vol_icon = "🔉";
 		else
 			vol_icon = "🔊";
-		row = g_list_append(row, g_strdup(vol_icon));
 
-		purple_notify_searchresults_row_add(results, row);
+		const gchar *row[] = { p->full_name, _(val->value_nick), screen_icon, vol_icon };
+		chime_sr_add_row(sr, row, G_N_ELEMENTS(row));
 
 		pl = g_list_remove(pl, p);
 	}
 	g_type_class_unref(klass);
-
-	return results;
-
 }
+
 static void on_call_participants(ChimeCall *call, GHashTable *participants, struct chime_chat *chat);
 
 static void participants_closed_cb(gpointer _chat)
 {
 	struct chime_chat *chat = _chat;
-	chat->participants_ui = NULL;
+	g_clear_pointer(&chat->participants_sr, chime_sr_free);
+	chat->participants = NULL;
 	g_signal_handlers_disconnect_matched(chat->call, G_SIGNAL_MATCH_FUNC|G_SIGNAL_MATCH_DATA,
 					     0, 0, NULL, G_CALLBACK(on_call_participants), chat);
 }
@@ -441,15 +440,18 @@ static void on_audio_state(ChimeCall *call, ChimeAudioState audio_state,
 
 static void on_call_participants(ChimeCall *call, GHashTable *participants, struct chime_chat *chat)
 {
-	PurpleNotifySearchResults *results = generate_sr_participants(participants);
 	PurpleConnection *conn = chat->conv->account->gc;
 
-	if (!chat->participants_ui) {
-		chat->participants_ui = purple_notify_searchresults(conn, _("Call Participants"),
-								    chime_meeting_get_name(chat->meeting),
-								    NULL, results, participants_closed_cb, chat);
+	chat->participants = participants;
+
+	if (!chat->participants_sr) {
+		chat->participants_sr = chime_sr_new(conn, participants_columns, participants_rows, chat);
+		if (!chime_sr_show(chat->participants_sr, _("Call Participants"),
+				   chime_meeting_get_name(chat->meeting),
+				   NULL, participants_closed_cb, chat))
+			g_clear_pointer(&chat->participants_sr, chime_sr_free);
 	} else {
-		purple_notify_searchresults_new_rows(conn, results, chat->participants_ui);
+		chime_sr_refresh(chat->participants_sr);
 	}
 }
 
@@ -801,10 +803,8 @@ void chime_destroy_chat(struct chime_chat *chat)
 		on_call_presenter(chat->call, NULL, chat);
 
 	if (chat->meeting) {
-		if (chat->participants_ui) {
-			purple_notify_close(PURPLE_NOTIFY_SEARCHRESULTS, chat->participants_ui);
-			chat->participants_ui = NULL;
-		}
+		if (chat->participants_sr)
+			chime_sr_close(chat->participants_sr);
 
 		g_signal_handlers_disconnect_matched(chat->call, G_SIGNAL_MATCH_DATA,
 						     0, 0, NULL, NULL, chat);
@@ -23,6 +23,7 @@
 #include <status.h>
 #include <debug.h>
 #include <request.h>
+#include <prefs.h>
 
 #include <glib/gi18n.h>
 #include <glib/gstrfuncs.h>
@@ -104,21 +105,9 @@ static void on_chime_connected(ChimeConnection *cxn, const gchar *display_name,
 	g_signal_connect(cxn, "new-contact",
 			 G_CALLBACK(on_chime_new_contact), conn);
 
-	/* Remove any contacts that don't exist */
-	GSList *l = purple_find_buddies(conn->account, NULL);
-	while (l) {
-		PurpleBuddy *buddy = l->data;
-		if (PURPLE_BLIST_NODE_SHOULD_SAVE(buddy)) {
-			ChimeContact *contact = chime_connection_contact_by_email(cxn,
-										  purple_buddy_get_name(buddy));
-			if (!contact || !chime_contact_get_contacts_list(contact))
-				purple_blist_remove_buddy(buddy);
-		}
-		l = g_slist_remove(l, buddy);
-	}
-
-	/* And add any that do, and monitor status for all */
-	chime_connection_foreach_contact(cxn, (ChimeContactCB)on_chime_new_contact, conn);
+	/* Remove any contacts that don't exist, add any that do, and
+	 * monitor status for all */
+	chime_purple_sync_buddies(conn);
 
 	/* Subscribe to RoomMessage on the device channel (now that we know it) and
 	 * check LastMentions on each known Room, opening a chat immediately if needed. */
@@ -155,6 +144,30 @@ static void on_chime_log_message(ChimeConnection *cxn, ChimeLogLevel lvl, const
 	purple_debug(purple_level_from_chime(lvl), "chime", "%s", str);
 }
 
+/* Tell libchime the lowest level that libpurple would actually print, so
+ * that it doesn't bother formatting messages which would be thrown away. */
+static void update_log_level(void)
+{
+	PurpleDebugUiOps *ops = purple_debug_get_ui_ops();
+	ChimeLogLevel lvl = CHIME_LOGLVL_MISC;
+
+	if (!purple_debug_is_enabled()) {
+		for (; lvl < CHIME_LOGLVL_FATAL; lvl++) {
+			if (ops && ops->print &&
+			    (!ops->is_enabled ||
+			     ops->is_enabled(purple_level_from_chime(lvl), "chime")))
+				break;
+		}
+	}
+	chime_log_set_level(lvl);
+}
+
+static void debug_pref_changed(const char *name, PurplePrefType type,
+			       gconstpointer val, gpointer data)
+{
+	update_log_level();
+}
+
 static void on_session_token_changed(ChimeConnection *connection, GParamSpec *pspec, PurpleConnection *conn)
 {
 	purple_debug(PURPLE_DEBUG_INFO, "chime", "Session token changed\n");
@@ -233,6 +246,9 @@ static void chime_purple_login(PurpleAccount *account)
 	pc->cxn = chime_connection_new(purple_account_get_username(account),
 				       server, devtoken, token);
 
+	chime_connection_set_mention_keywords(pc->cxn,
+					      purple_account_get_string(account, "mention-keywords", NULL));
+
 	g_signal_connect(pc->cxn, "notify::session-token",
 			 G_CALLBACK(on_session_token_changed), conn);
 	g_signal_connect(pc->cxn, "authenticate",
@@ -252,6 +268,22 @@ static void chime_purple_login(PurpleAccount *account)
 	g_signal_connect(pc->cxn, "log-message",
 			 G_CALLBACK(on_chime_log_message), NULL);
 
+	/* Pidgin's debug window toggles this when it's opened and closed */
+	update_log_level();
+	if (purple_prefs_exists("/pidgin/debug"))
+		purple_prefs_connect_callback(pc, "/pidgin/debug", debug_pref_changed, NULL);
+
+	const gchar *metrics_socket = purple_account_get_string(account, "metrics-socket", NULL);
+	if (metrics_socket && *metrics_socket) {
+		GError *error = NULL;
+
+		if (!chime_connection_serve_metrics(pc->cxn, metrics_socket, &error)) {
+			purple_debug(PURPLE_DEBUG_WARNING, "chime", "Failed to serve metrics on %s: %s\n",
+				     metrics_socket, error->message);
+			g_error_free(error);
+		}
+	}
+
 	chime_connection_connect(pc->cxn);
 }
 
@@ -271,6 +303,9 @@ static void chime_purple_close(PurpleConnection *conn)
 	g_signal_handlers_disconnect_matched(pc->cxn, G_SIGNAL_MATCH_DATA,
 					     0, 0, NULL, NULL, conn);
 
+	purple_prefs_disconnect_by_handle(pc);
+
+	purple_chime_destroy_buddies(conn);
 	purple_chime_destroy_meetings(conn);
 	purple_chime_destroy_messages(conn);
 	purple_chime_destroy_conversations(conn);
@@ -378,6 +413,7 @@ static PurplePluginProtocolInfo chime_prpl_info = {
 	.chat_leave = chime_purple_chat_leave,
 	.chat_send = chime_purple_chat_send,
 	.roomlist_get_list = chime_purple_roomlist_get_list,
+	.roomlist_expand_category = chime_purple_roomlist_expand_category,
 	.chat_info_defaults = chime_purple_chat_info_defaults,
 	.get_chat_name = chime_purple_get_chat_name,
 	.roomlist_room_serialize = chime_purple_roomlist_room_serialize,
@@ -403,6 +439,63 @@ static void chime_purple_show_about_plugin(PurplePluginAction *action)
 				NULL, NULL);
 }
 
+static void append_log_record(gint64 time, ChimeLogLevel level, const gchar *category,
+			      const gchar *message, gpointer _str)
+{
+	static const gchar *levels[] = { "misc", "info", "warning", "error", "fatal" };
+	GString *str = _str;
+	GDateTime *dt = g_date_time_new_from_unix_local(time / G_USEC_PER_SEC);
+	gchar *when = g_date_time_format(dt, "%T");
+	gchar *escaped = g_markup_escape_text(message, -1);
+
+	g_string_append_printf(str, "(%s.%03d) %s%s%s: %s<br>", when,
+			       (int)(time % G_USEC_PER_SEC) / 1000,
+			       level < G_N_ELEMENTS(levels) ? levels[level] : "?",
+			       category ? "/" : "", category ? category : "", escaped);
+	g_free(escaped);
+	g_free(when);
+	g_date_time_unref(dt);
+}
+
+static void show_plain_text(PurpleConnection *conn, const gchar *title, const gchar *text)
+{
+	gchar *escaped = g_markup_escape_text(text, -1);
+	gchar **lines = g_strsplit(escaped, "\n", -1);
+	gchar *body = g_strjoinv("<br>", lines);
+
+	purple_notify_formatted(conn, NULL, title, NULL, body, NULL, NULL);
+	g_free(body);
+	g_strfreev(lines);
+	g_free(escaped);
+}
+
+static void chime_purple_show_metrics(PurplePluginAction *action)
+{
+	PurpleConnection *conn = action->context;
+	gchar *metrics = chime_connection_get_metrics(PURPLE_CHIME_CXN(conn));
+
+	show_plain_text(conn, _("Chime metrics"), metrics);
+	g_free(metrics);
+}
+
+static void chime_purple_show_memory(PurplePluginAction *action)
+{
+	gchar *report = chime_mem_report();
+
+	show_plain_text(action->context, _("Chime memory usage"), report);
+	g_free(report);
+}
+
+static void chime_purple_show_log(PurplePluginAction *action)
+{
+	GString *str = g_string_new("");
+
+	chime_log_ring_foreach(append_log_record, str);
+	purple_notify_formatted(action->context, NULL, _("Recent debug log"), NULL,
+				str->len ? str->str : _("(empty)"), NULL, NULL);
+	g_string_free(str, TRUE);
+}
+
 static void logout_done(GObject *source, GAsyncResult *result, gpointer _conn)
 {
 	PurpleConnection *conn = _conn;
@@ -473,6 +566,18 @@ static GList *chime_purple_plugin_actions(PurplePlugin *plugin,
 				       chime_purple_pin_join);
 	acts = g_list_append(acts, act);
 
+	act = purple_plugin_action_new(_("Show metrics..."),
+				       chime_purple_show_metrics);
+	acts = g_list_append(acts, act);
+
+	act = purple_plugin_action_new(_("Show memory usage..."),
+				       chime_purple_show_memory);
+	acts = g_list_append(acts, act);
+
+	act = purple_plugin_action_new(_("Show recent debug log..."),
+				       chime_purple_show_log);
+	acts = g_list_append(acts, act);
+
 	act = purple_plugin_action_new(_("Log out..."),
 				       chime_purple_logout);
 	acts = g_list_append(acts, act);
@@ -511,6 +616,18 @@ static void chime_purple_init_plugin(PurplePlugin *plugin)
 	opt = purple_account_option_string_new(_("Token"), "token", NULL);
 	opts = g_list_append(opts, opt);
 
+	opt = purple_account_option_int_new(_("Prepare to join meetings this many minutes before they start (0 to disable)"),
+					    "meeting-warmup", 0);
+	opts = g_list_append(opts, opt);
+
+	opt = purple_account_option_string_new(_("Also treat these words as mentions (comma-separated)"),
+					       "mention-keywords", NULL);
+	opts = g_list_append(opts, opt);
+
+	opt = purple_account_option_string_new(_("Serve metrics on this Unix socket"),
+					       "metrics-socket", NULL);
+	opts = g_list_append(opts, opt);
+
 	chime_prpl_info.protocol_options = opts;
 
 #ifndef PRPL_HAS_GET_CB_ALIAS
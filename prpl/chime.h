@@ -37,19 +37,20 @@ struct purple_chime {
 	GHashTable *ims_by_email;
 	GHashTable *ims_by_profile_id;
 
+	/* Contacts whose buddies need reconciling → whether to remove them */
+	GHashTable *buddy_sync_pending;
+	guint buddy_sync_id;
+
 	GRegex *mention_regex;
 	GHashTable *chats_by_room;
 	GHashTable *live_chats;
 	int chat_id;
 
-	void *convlist_handle;
-	guint convlist_refresh_id;
-
-	void *joinable_handle;
-	guint joinable_refresh_id;
+	struct chime_sr *convlist;
+	struct chime_sr *joinable;
 
 	/* Allow pin_join to abort a 'joinable meetings' popup */
-	GSList *pin_joins;
+	GHashTable *pin_joins;
 };
 
 #define PURPLE_CHIME_CXN(conn) (CHIME_CONNECTION(((struct purple_chime *)purple_connection_get_protocol_data(conn))->cxn))
@@ -65,6 +66,8 @@ gboolean chime_read_last_msg(PurpleConnection *conn, ChimeObject *obj,
 
 /* buddy.c */
 void on_chime_new_contact(ChimeConnection *cxn, ChimeContact *contact, PurpleConnection *conn);
+void chime_purple_sync_buddies(PurpleConnection *conn);
+void purple_chime_destroy_buddies(PurpleConnection *conn);
 void chime_purple_buddy_free(PurpleBuddy *buddy);
 void chime_purple_add_buddy(PurpleConnection *conn, PurpleBuddy *buddy, PurpleGroup *group);
 void chime_purple_remove_buddy(PurpleConnection *conn, PurpleBuddy *buddy, PurpleGroup *group);
@@ -84,6 +87,8 @@ gboolean chime_purple_initiate_media(PurpleAccount *account, const char *who,
 
 /* rooms.c */
 PurpleRoomlist *chime_purple_roomlist_get_list(PurpleConnection *conn);
+void chime_purple_roomlist_expand_category(PurpleRoomlist *roomlist,
+					   PurpleRoomlistRoom *category);
 GList *chime_purple_chat_info(PurpleConnection *conn);
 GHashTable *chime_purple_chat_info_defaults(PurpleConnection *conn, const char *name);
 char *chime_purple_get_chat_name(GHashTable *components);
@@ -137,6 +142,20 @@ void init_msgs(PurpleConnection *conn, struct chime_msgs *msgs, ChimeObject *obj
 void purple_chime_init_messages(PurpleConnection *conn);
 void purple_chime_destroy_messages(PurpleConnection *conn);
 
+/* searchresults.c */
+struct chime_sr;
+typedef void (*chime_sr_columns_fn)(PurpleNotifySearchResults *results);
+typedef void (*chime_sr_rows_fn)(struct chime_sr *sr, gpointer data);
+
+struct chime_sr *chime_sr_new(PurpleConnection *conn, chime_sr_columns_fn columns,
+			      chime_sr_rows_fn rows, gpointer data);
+void chime_sr_add_row(struct chime_sr *sr, const gchar *const *cols, guint n);
+void *chime_sr_show(struct chime_sr *sr, const char *title, const char *primary,
+		    const char *secondary, PurpleNotifyCloseCallback cb, gpointer user_data);
+void chime_sr_refresh(struct chime_sr *sr);
+void chime_sr_close(struct chime_sr *sr);
+void chime_sr_free(struct chime_sr *sr);
+
 /* attachments.c */
 
 /*
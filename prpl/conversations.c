@@ -23,6 +23,7 @@
 #include <prpl.h>
 #include <blist.h>
 #include <debug.h>
+#include <ft.h>
 
 #include "chime.h"
 
@@ -242,7 +243,9 @@ unsigned int chime_send_typing(PurpleConnection *conn, const char *name, PurpleT
 
 	chime_conversation_send_typing(pc->cxn, CHIME_CONVERSATION(im->m.obj), state == PURPLE_TYPING);
 
-	return 0;
+	/* Have Pidgin tell us again if the user is still typing after this
+	 * long; libchime throttles anything more frequent anyway. */
+	return state == PURPLE_TYPING ? CHIME_TYPING_INTERVAL : 0;
 }
 
 static void sent_im_cb(GObject *source, GAsyncResult *result, gpointer _imd)
@@ -395,11 +398,7 @@ static void convlist_closed_cb(gpointer _conn)
 	if (!pc)
 		return;
 
-	if (pc->convlist_refresh_id) {
-		g_source_remove(pc->convlist_refresh_id);
-		pc->convlist_refresh_id = 0;
-	}
-	pc->convlist_handle = NULL;
+	g_clear_pointer(&pc->convlist, chime_sr_free);
 
 	/* Unsubscribe from all the signals that were updating the dialog contents */
 	chime_connection_foreach_conversation(PURPLE_CHIME_CXN(conn), (void *)unsub_conv_object, conn);
@@ -441,9 +440,8 @@ static void insert_conv(ChimeConnection *cxn, ChimeConversation *conv, gpointer
 	*convs = g_list_insert_sorted(*convs, conv, (GCompareFunc) compare_conv_date);
 }
 
-static PurpleNotifySearchResults *generate_recent_convs(PurpleConnection *conn)
+static void recent_convs_columns(PurpleNotifySearchResults *results)
 {
-	PurpleNotifySearchResults *results = purple_notify_searchresults_new();
 	PurpleNotifySearchColumn *column;
 
 	column = purple_notify_searchresults_column_new(_("Who"));
@@ -454,7 +452,11 @@ static PurpleNotifySearchResults *generate_recent_convs(PurpleConnection *conn)
 	purple_notify_searchresults_column_add(results, column);
 
 	purple_notify_searchresults_button_add(results, PURPLE_NOTIFY_BUTTON_IM, open_im_conv);
+}
 
+static void recent_convs_rows(struct chime_sr *sr, gpointer _conn)
+{
+	PurpleConnection *conn = _conn;
 	GList *convs = NULL;
 	chime_connection_foreach_conversation(PURPLE_CHIME_CXN(conn), insert_conv, &convs);
 
@@ -464,23 +466,23 @@ static PurpleNotifySearchResults *generate_recent_convs(PurpleConnection *conn)
 		ChimeConversation *conv = convs->data;
 		convs = g_list_delete_link(convs, convs);
 
-		GList *row = NULL;
-		row = g_list_append(row, g_strdup(chime_conversation_get_name(conv)));
-		row = g_list_append(row, g_strdup(chime_conversation_get_updated_on(conv)));
-
+		const gchar *availability;
 		ChimeContact *peer = NULL;
 		if (is_group_conv(PURPLE_CHIME_CXN(conn), conv, &peer)) {
-			row = g_list_append(row, g_strdup("(N/A)"));
+			availability = "(N/A)";
 		} else {
 			GEnumValue *val = g_enum_get_value(klass, chime_contact_get_availability(peer));
-			row = g_list_append(row, g_strdup(_(val->value_nick)));
+			availability = _(val->value_nick);
 			g_signal_handlers_disconnect_matched(peer, G_SIGNAL_MATCH_FUNC|G_SIGNAL_MATCH_DATA, 0, 0, NULL,
 						     G_CALLBACK(refresh_convlist), conn);
 			g_signal_connect(peer, "notify::availability", G_CALLBACK(refresh_convlist), conn);
 			g_object_unref(peer);
 		}
 
-		purple_notify_searchresults_row_add(results, row);
+		const gchar *row[] = { chime_conversation_get_name(conv),
+				       chime_conversation_get_updated_on(conv),
+				       availability };
+		chime_sr_add_row(sr, row, G_N_ELEMENTS(row));
 
 		g_signal_handlers_disconnect_matched(conv, G_SIGNAL_MATCH_FUNC|G_SIGNAL_MATCH_DATA, 0, 0, NULL,
 						     G_CALLBACK(refresh_convlist), conn);
@@ -489,29 +491,14 @@ static PurpleNotifySearchResults *generate_recent_convs(PurpleConnection *conn)
 	}
 
 	g_type_class_unref(klass);
-	return results;
-}
-
-static gboolean update_convlist(gpointer _conn)
-{
-	PurpleConnection *conn = _conn;
-	struct purple_chime *pc = purple_connection_get_protocol_data(conn);
-
-	PurpleNotifySearchResults *results = generate_recent_convs(conn);
-	purple_notify_searchresults_new_rows(conn, results, pc->convlist_handle);
-
-	pc->convlist_refresh_id = 0;
-	return FALSE;
 }
 
 static void refresh_convlist(ChimeObject *obj, GParamSpec *pspec, PurpleConnection *conn)
 {
 	struct purple_chime *pc = purple_connection_get_protocol_data(conn);
 
-	if (!pc->convlist_handle || pc->convlist_refresh_id)
-		return;
-
-	pc->convlist_refresh_id = g_idle_add(update_convlist, conn);
+	if (pc->convlist)
+		chime_sr_refresh(pc->convlist);
 }
 
 void chime_purple_recent_conversations(PurplePluginAction *action)
@@ -519,18 +506,16 @@ void chime_purple_recent_conversations(PurplePluginAction *action)
 	PurpleConnection *conn = (PurpleConnection *) action->context;
 	struct purple_chime *pc = purple_connection_get_protocol_data(conn);
 
-	if (pc->convlist_handle) {
-		if (!pc->convlist_refresh_id)
-			pc->convlist_refresh_id = g_idle_add(update_convlist, conn);
+	if (pc->convlist) {
+		chime_sr_refresh(pc->convlist);
 		return;
 	}
 
-	PurpleNotifySearchResults *results = generate_recent_convs(conn);
-	pc->convlist_handle = purple_notify_searchresults(conn, _("Recent Chime Conversations"),
-							  _("Recent conversations:"),
-							  conn->account->username, results,
-							  convlist_closed_cb, conn);
-	if (!pc->convlist_handle) {
+	pc->convlist = chime_sr_new(conn, recent_convs_columns, recent_convs_rows, conn);
+	if (!chime_sr_show(pc->convlist, _("Recent Chime Conversations"),
+			   _("Recent conversations:"),
+			   conn->account->username,
+			   convlist_closed_cb, conn)) {
 		purple_notify_error(conn, NULL,
 				    _("Unable to display recent conversations."),
 				    NULL);
@@ -564,6 +549,6 @@ void purple_chime_destroy_conversations(PurpleConnection *conn)
 	g_clear_pointer(&pc->ims_by_email, g_hash_table_destroy);
 	g_clear_pointer(&pc->ims_by_profile_id, g_hash_table_destroy);
 
-	if (pc->convlist_handle)
+	if (pc->convlist)
 		convlist_closed_cb(conn);
 }
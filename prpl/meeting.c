@@ -232,7 +232,13 @@ static void pin_join_done(GObject *source, GAsyncResult *result, gpointer _pjd)
 		g_object_unref(mtg);
 	}
 
-	pc->pin_joins = g_slist_remove(pc->pin_joins, pjd->query);
+	if (pc->pin_joins) {
+		guint count = GPOINTER_TO_UINT(g_hash_table_lookup(pc->pin_joins, pjd->query));
+		if (count > 1)
+			g_hash_table_insert(pc->pin_joins, g_strdup(pjd->query), GUINT_TO_POINTER(count - 1));
+		else
+			g_hash_table_remove(pc->pin_joins, pjd->query);
+	}
 	free(pjd->query);
 	free(pjd);
 }
@@ -246,7 +252,8 @@ static void pin_join_begin(PurpleConnection *conn, const char *query, gboolean m
 	pjd->muted = muted;
 	pjd->conn = conn;
 	pjd->query = g_strdup(query);
-	pc->pin_joins = g_slist_prepend(pc->pin_joins, pjd->query);
+	guint count = GPOINTER_TO_UINT(g_hash_table_lookup(pc->pin_joins, query));
+	g_hash_table_insert(pc->pin_joins, g_strdup(query), GUINT_TO_POINTER(count + 1));
 
 	chime_connection_lookup_meeting_by_pin_async(cxn, query, NULL,
 						     pin_join_done, pjd);
@@ -325,24 +332,24 @@ static void join_joinable(PurpleConnection *conn, GList *row, gpointer _unused)
 	do_join_joinable(conn, row, TRUE);
 }
 
-static void append_mtg(ChimeConnection *cxn, ChimeMeeting *mtg, gpointer _results)
+static void append_mtg(ChimeConnection *cxn, ChimeMeeting *mtg, gpointer _sr)
 {
-	PurpleNotifySearchResults *results = _results;
+	struct chime_sr *sr = _sr;
 	ChimeContact *organiser = chime_meeting_get_organiser(mtg);
 
-	GList *row = NULL;
-	row = g_list_append(row, format_pin(chime_meeting_get_passcode(mtg)));
-	row = g_list_append(row, g_strdup(chime_meeting_get_name(mtg)));
-	row = g_list_append(row, g_strdup_printf("%s <%s>", chime_contact_get_display_name(organiser),
-						 chime_contact_get_email(organiser)));
+	gchar *pin = format_pin(chime_meeting_get_passcode(mtg));
+	gchar *org = g_strdup_printf("%s <%s>", chime_contact_get_display_name(organiser),
+				     chime_contact_get_email(organiser));
 
-	purple_notify_searchresults_row_add(results, row);
-}
+	const gchar *row[] = { pin, chime_meeting_get_name(mtg), org };
+	chime_sr_add_row(sr, row, G_N_ELEMENTS(row));
 
+	g_free(pin);
+	g_free(org);
+}
 
-static PurpleNotifySearchResults *generate_joinable_results(PurpleConnection *conn)
+static void joinable_columns(PurpleNotifySearchResults *results)
 {
-	PurpleNotifySearchResults *results = purple_notify_searchresults_new();
 	PurpleNotifySearchColumn *column;
 
 	column = purple_notify_searchresults_column_new(_("Passcode"));
@@ -355,46 +362,24 @@ static PurpleNotifySearchResults *generate_joinable_results(PurpleConnection *co
 	purple_notify_searchresults_button_add(results, PURPLE_NOTIFY_BUTTON_JOIN, join_joinable);
 	/* This doesn't show up in Pidgin < 2.13: https://developer.pidgin.im/ticket/17188 */
 	purple_notify_searchresults_button_add_labeled(results, _("Join with audio"), join_joinable_audio);
-
-	chime_connection_foreach_meeting(PURPLE_CHIME_CXN(conn), append_mtg, results);
-	return results;
 }
 
-static gboolean update_joinable(gpointer _conn)
+static void joinable_rows(struct chime_sr *sr, gpointer _conn)
 {
 	PurpleConnection *conn = _conn;
-	struct purple_chime *pc = purple_connection_get_protocol_data(conn);
-
-	PurpleNotifySearchResults *results = generate_joinable_results(conn);
-	purple_notify_searchresults_new_rows(conn, results, pc->joinable_handle);
-
-	pc->joinable_refresh_id = 0;
-	return FALSE;
-}
-
-static void count_mtg(ChimeConnection *cxn, ChimeMeeting *mtg, gpointer _count)
-{
-	int *count = _count;
 
-	(*count)++;
+	chime_connection_foreach_meeting(PURPLE_CHIME_CXN(conn), append_mtg, sr);
 }
 
 static void on_joinable_changed(ChimeMeeting *mtg, GParamSpec *ignored, PurpleConnection *conn)
 {
 	struct purple_chime *pc = purple_connection_get_protocol_data(conn);
 
-	if (pc->joinable_handle) {
-		int count = 0;
-
-		chime_connection_foreach_meeting(PURPLE_CHIME_CXN(conn), count_mtg, &count);
-		if (!count) {
-			if (pc->joinable_refresh_id)
-				g_source_remove(pc->joinable_refresh_id);
-			pc->joinable_refresh_id = 0;
-			purple_notify_close(PURPLE_NOTIFY_SEARCHRESULTS, pc->joinable_handle);
-			pc->joinable_handle = NULL;
-		} else if (!pc->joinable_refresh_id)
-			pc->joinable_refresh_id = g_idle_add(update_joinable, conn);
+	if (pc->joinable) {
+		if (!chime_connection_joinable_meeting_count(PURPLE_CHIME_CXN(conn)))
+			chime_sr_close(pc->joinable);
+		else
+			chime_sr_refresh(pc->joinable);
 	}
 }
 
@@ -412,11 +397,7 @@ static void joinable_closed_cb(gpointer _conn)
 	if (!pc)
 		return;
 
-	if (pc->joinable_refresh_id) {
-		g_source_remove(pc->joinable_refresh_id);
-		pc->joinable_refresh_id = 0;
-	}
-	pc->joinable_handle = NULL;
+	g_clear_pointer(&pc->joinable, chime_sr_free);
 
 	chime_connection_foreach_meeting(PURPLE_CHIME_CXN(conn), unsub_mtg, conn);
 }
@@ -437,29 +418,34 @@ void on_chime_new_meeting(ChimeConnection *cxn, ChimeMeeting *mtg, PurpleConnect
 {
 	struct purple_chime *pc = purple_connection_get_protocol_data(conn);
 
-	if (pc->joinable_handle) {
+	if (mtg) {
+		int warmup = purple_account_get_int(conn->account, "meeting-warmup", 0);
+		if (warmup > 0)
+			chime_connection_warm_up_meeting(cxn, mtg, warmup);
+	}
+
+	if (pc->joinable) {
 		if (mtg)
 			sub_mtg(cxn, mtg, conn);
 
-		if (!pc->joinable_refresh_id)
-			pc->joinable_refresh_id = g_idle_add(update_joinable, conn);
+		chime_sr_refresh(pc->joinable);
 		return;
 	}
 
 	/* Don't pop up the 'Joinable Meetings' dialog if this is was triggered by a PIN join.
 	   We're about to join it directly anyway. */
 	if (mtg) {
-		GSList *l;
-		for (l = pc->pin_joins; l; l = l->next) {
-			if (chime_meeting_match_pin(mtg, l->data))
-				return;
-		}
+		const gchar *passcode = chime_meeting_get_passcode(mtg);
+		const gchar *display_id = chime_meeting_get_id_for_display(mtg);
+
+		if ((passcode && g_hash_table_contains(pc->pin_joins, passcode)) ||
+		    (display_id && g_hash_table_contains(pc->pin_joins, display_id)))
+			return;
 	}
 
-	PurpleNotifySearchResults *results = generate_joinable_results(conn);
-	pc->joinable_handle = purple_notify_searchresults(conn, _("Joinable Chime Meetings"), _("Joinable Meetings:"),
-							  conn->account->username, results, joinable_closed_cb, conn);
-	if (!pc->joinable_handle) {
+	pc->joinable = chime_sr_new(conn, joinable_columns, joinable_rows, conn);
+	if (!chime_sr_show(pc->joinable, _("Joinable Chime Meetings"), _("Joinable Meetings:"),
+			   conn->account->username, joinable_closed_cb, conn)) {
 		purple_notify_error(conn, NULL,
 				    _("Unable to display joinable meetings."),
 				    NULL);
@@ -478,14 +464,20 @@ void chime_purple_show_joinable(PurplePluginAction *action)
 
 void purple_chime_init_meetings(PurpleConnection *conn)
 {
+	struct purple_chime *pc = purple_connection_get_protocol_data(conn);
+
+	/* PIN → number of joins in progress with that PIN */
+	pc->pin_joins = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 }
 
 void purple_chime_destroy_meetings(PurpleConnection *conn)
 {
 	struct purple_chime *pc = purple_connection_get_protocol_data(conn);
 
-	if (pc->joinable_handle)
+	if (pc->joinable)
 		joinable_closed_cb(conn);
+
+	g_clear_pointer(&pc->pin_joins, g_hash_table_unref);
 }
 
 static void media_initiated_cb(GObject *source, GAsyncResult *result, gpointer _conn)
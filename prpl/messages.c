@@ -133,6 +133,12 @@ static gboolean msg_newer(JsonNode *old, JsonNode *new)
 	return FALSE;
 }
 
+static void unref_gathered_msg(gpointer node)
+{
+	chime_mem_account(CHIME_MEM_MSG_GATHER, 0, -1);
+	json_node_unref(node);
+}
+
 static void on_message_received(ChimeObject *obj, JsonNode *node, struct chime_msgs *msgs)
 {
 	ChimeConnection *cxn = PURPLE_CHIME_CXN(msgs->conn);
@@ -149,6 +155,7 @@ static void on_message_received(ChimeObject *obj, JsonNode *node, struct chime_m
 			g_hash_table_remove(msgs->msg_gather, id);
 		}
 		g_hash_table_insert(msgs->msg_gather, (gchar *)id, json_node_ref(node));
+		chime_mem_account(CHIME_MEM_MSG_GATHER, 0, 1);
 		return;
 	}
 	GTimeVal tv;
@@ -202,7 +209,7 @@ static void on_last_sent_updated(ChimeObject *obj, GParamSpec *ignored, struct c
 
 		chime_connection_fetch_messages_async(PURPLE_CHIME_CXN(msgs->conn), obj, NULL, msgs->last_seen, NULL, fetch_msgs_cb, msgs);
 		msgs->msgs_done = FALSE;
-		msgs->msg_gather = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)json_node_unref);
+		msgs->msg_gather = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, unref_gathered_msg);
 	}
 
 	g_free(last_sent);
@@ -252,7 +259,7 @@ void init_msgs(PurpleConnection *conn, struct chime_msgs *msgs, ChimeObject *obj
 	}
 
 	if (!msgs->msgs_done || !msgs->members_done)
-		msgs->msg_gather = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)json_node_unref);
+		msgs->msg_gather = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, unref_gathered_msg);
 
 	if (first_msg)
 		on_message_received(obj, first_msg, msgs);
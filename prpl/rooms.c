@@ -15,6 +15,7 @@
  * Lesser General Public License for more details.
  */
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <glib/gi18n.h>
@@ -30,18 +31,85 @@
 
 #include <libsoup/soup.h>
 
-static void add_room_to_list(ChimeConnection *cxn, ChimeRoom *room, gpointer _roomlist)
+/* With more rooms than this, the list is split into categories which
+ * are each only filled in when they're expanded. */
+#define ROOMLIST_PAGE_SIZE 100
+
+struct roomlist_page {
+	PurpleRoomlist *roomlist;
+	PurpleRoomlistRoom *parent;
+};
+
+static void add_room_to_list(ChimeConnection *cxn, ChimeRoom *room, gpointer _page)
 {
-	PurpleRoomlist *roomlist = _roomlist;
+	struct roomlist_page *page = _page;
+	PurpleRoomlist *roomlist = page->roomlist;
 
 	PurpleRoomlistRoom *proom = purple_roomlist_room_new(PURPLE_ROOMLIST_ROOMTYPE_ROOM,
-	                                                     chime_room_get_name(room), NULL);
+	                                                     chime_room_get_name(room), page->parent);
 	purple_roomlist_room_add_field(roomlist, proom, chime_room_get_id(room));
 	purple_roomlist_room_add_field(roomlist, proom, GUINT_TO_POINTER(chime_room_get_visibility(room)));
 	purple_roomlist_room_add_field(roomlist, proom, GUINT_TO_POINTER(chime_room_get_privacy(room)));
+
+	guint unread = 0;
+	chime_connection_get_unread(cxn, CHIME_OBJECT(room), &unread, NULL);
+	purple_roomlist_room_add_field(roomlist, proom, GUINT_TO_POINTER(unread));
 	purple_roomlist_room_add(roomlist, proom);
 }
 
+static void add_unread_to_list(ChimeConnection *cxn, ChimeObject *obj, gpointer _page)
+{
+	if (CHIME_IS_ROOM(obj))
+		add_room_to_list(cxn, CHIME_ROOM(obj), _page);
+}
+
+static void get_room_name(ChimeConnection *cxn, ChimeRoom *room, gpointer _name)
+{
+	*(const gchar **)_name = chime_room_get_name(room);
+}
+
+static void get_room(ChimeConnection *cxn, ChimeRoom *room, gpointer _room)
+{
+	*(ChimeRoom **)_room = room;
+}
+
+static void add_page_to_list(ChimeConnection *cxn, PurpleRoomlist *roomlist,
+			     guint offset, guint total)
+{
+	const gchar *first = NULL, *last = NULL;
+	guint end = MIN(offset + ROOMLIST_PAGE_SIZE, total);
+
+	chime_connection_search_rooms(cxn, NULL, offset, 1, get_room_name, &first);
+	chime_connection_search_rooms(cxn, NULL, end - 1, 1, get_room_name, &last);
+
+	gchar *label = g_strdup_printf("%s – %s", first, last);
+	PurpleRoomlistRoom *category = purple_roomlist_room_new(PURPLE_ROOMLIST_ROOMTYPE_CATEGORY,
+								label, NULL);
+	g_free(label);
+
+	/* The hidden RoomId field of a category holds the offset of its page */
+	gchar *offset_str = g_strdup_printf("%u", offset);
+	purple_roomlist_room_add_field(roomlist, category, offset_str);
+	g_free(offset_str);
+	purple_roomlist_room_add_field(roomlist, category, GUINT_TO_POINTER(FALSE));
+	purple_roomlist_room_add_field(roomlist, category, GUINT_TO_POINTER(FALSE));
+	purple_roomlist_room_add_field(roomlist, category, GUINT_TO_POINTER(0));
+	purple_roomlist_room_add(roomlist, category);
+}
+
+/* The most recently active of those with unread messages, ahead of the pages */
+static void add_unread_category(PurpleRoomlist *roomlist)
+{
+	PurpleRoomlistRoom *category = purple_roomlist_room_new(PURPLE_ROOMLIST_ROOMTYPE_CATEGORY,
+								_("Unread"), NULL);
+
+	purple_roomlist_room_add_field(roomlist, category, "unread");
+	purple_roomlist_room_add_field(roomlist, category, GUINT_TO_POINTER(FALSE));
+	purple_roomlist_room_add_field(roomlist, category, GUINT_TO_POINTER(FALSE));
+	purple_roomlist_room_add_field(roomlist, category, GUINT_TO_POINTER(0));
+	purple_roomlist_room_add(roomlist, category);
+}
+
 PurpleRoomlist *chime_purple_roomlist_get_list(PurpleConnection *conn)
 {
 	ChimeConnection *cxn = PURPLE_CHIME_CXN(conn);
@@ -52,14 +120,52 @@ PurpleRoomlist *chime_purple_roomlist_get_list(PurpleConnection *conn)
 	fields = g_list_append(fields, purple_roomlist_field_new(PURPLE_ROOMLIST_FIELD_STRING, "", "RoomId", TRUE));
 	fields = g_list_append(fields, purple_roomlist_field_new(PURPLE_ROOMLIST_FIELD_BOOL, _("Visible"), "Visibility", FALSE));
 	fields = g_list_append(fields, purple_roomlist_field_new(PURPLE_ROOMLIST_FIELD_BOOL, _("Private"), "Privacy", FALSE));
+	fields = g_list_append(fields, purple_roomlist_field_new(PURPLE_ROOMLIST_FIELD_INT, _("Unread"), "Unread", FALSE));
 	purple_roomlist_set_fields(roomlist, fields);
 
-	chime_connection_foreach_room(cxn, add_room_to_list, roomlist);
+	guint total = chime_connection_search_rooms(cxn, NULL, 0, 0, NULL, NULL);
+	if (total <= ROOMLIST_PAGE_SIZE) {
+		struct roomlist_page page = { roomlist, NULL };
+
+		chime_connection_search_rooms(cxn, NULL, 0, 0, add_room_to_list, &page);
+	} else {
+		guint offset;
+
+		if (chime_connection_foreach_unread(cxn, 0, NULL, NULL))
+			add_unread_category(roomlist);
+		for (offset = 0; offset < total; offset += ROOMLIST_PAGE_SIZE)
+			add_page_to_list(cxn, roomlist, offset, total);
+	}
 
 	purple_roomlist_set_in_progress(roomlist, FALSE);
 	return roomlist;
 }
 
+void chime_purple_roomlist_expand_category(PurpleRoomlist *roomlist,
+					   PurpleRoomlistRoom *category)
+{
+	PurpleConnection *conn = purple_account_get_connection(roomlist->account);
+	struct roomlist_page page = { roomlist, category };
+
+	if (category->type != PURPLE_ROOMLIST_ROOMTYPE_CATEGORY || !conn)
+		return;
+
+	if (!strcmp(category->fields->data, "unread")) {
+		chime_connection_foreach_unread(PURPLE_CHIME_CXN(conn), ROOMLIST_PAGE_SIZE,
+						add_unread_to_list, &page);
+		purple_roomlist_set_in_progress(roomlist, FALSE);
+		return;
+	}
+
+	/* Rooms which came or went since the list was opened may shift
+	 * things by a few places between pages; that's harmless. */
+	guint offset = strtoul(category->fields->data, NULL, 10);
+	chime_connection_search_rooms(PURPLE_CHIME_CXN(conn), NULL, offset,
+				      ROOMLIST_PAGE_SIZE, add_room_to_list, &page);
+
+	purple_roomlist_set_in_progress(roomlist, FALSE);
+}
+
 gchar *chime_purple_roomlist_room_serialize(PurpleRoomlistRoom *room)
 {
 	/* We use the RoomId as it *uniquely* identifies the room */
@@ -97,6 +203,19 @@ GHashTable *chime_purple_chat_info_defaults(PurpleConnection *conn, const char *
 		ChimeRoom *room = chime_connection_room_by_id(cxn, name);
 		if (!room)
 			room = chime_connection_room_by_name(cxn, name);
+		if (!room) {
+			/* An exact match ignoring case sorts first of those
+			 * which have it as a prefix */
+			chime_connection_search_rooms(cxn, name, 0, 1, get_room, &room);
+			if (room) {
+				gchar *a = g_utf8_casefold(chime_room_get_name(room), -1);
+				gchar *b = g_utf8_casefold(name, -1);
+				if (strcmp(a, b))
+					room = NULL;
+				g_free(a);
+				g_free(b);
+			}
+		}
 
 		if (room) {
 			g_hash_table_insert(hash, (char *)"Name", g_strdup(chime_room_get_name(room)));
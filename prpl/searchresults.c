@@ -0,0 +1,200 @@
+/*
+ * Pidgin/libpurple Chime client plugin
+ *
+ * Copyright © 2017 Amazon.com, Inc. or its affiliates.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include <string.h>
+
+#include <glib/gi18n.h>
+
+#include <prpl.h>
+#include <debug.h>
+
+#include "chime.h"
+
+/*
+ * Search results dialogs which are kept up to date as things change.
+ *
+ * The rows are kept as a model of string vectors, and a refresh only
+ * reaches the UI if the rows actually differ from what's displayed.
+ * Refreshes are also rate-limited, so a burst of updates (such as the
+ * volume changes from every participant in a big call) results in at
+ * most one redraw per interval.
+ *
+ * libpurple can only replace all the rows of a search results dialog at
+ * once, so when something has changed we still push the whole set.
+ */
+#define SR_REFRESH_INTERVAL 500 /* ms */
+
+struct chime_sr {
+	PurpleConnection *conn;
+	void *ui_handle;
+	chime_sr_columns_fn columns;
+	chime_sr_rows_fn rows;
+	gpointer data;
+	guint ncols;
+
+	GPtrArray *shown;	/* gchar ** for each row in the dialog */
+	GPtrArray *building;	/* ... and while chime_sr_rows_fn is running */
+	guint refresh_id;
+	gint64 last_shown;
+};
+
+struct chime_sr *chime_sr_new(PurpleConnection *conn, chime_sr_columns_fn columns,
+			      chime_sr_rows_fn rows, gpointer data)
+{
+	struct chime_sr *sr = g_new0(struct chime_sr, 1);
+
+	sr->conn = conn;
+	sr->columns = columns;
+	sr->rows = rows;
+	sr->data = data;
+
+	PurpleNotifySearchResults *results = purple_notify_searchresults_new();
+	columns(results);
+	sr->ncols = purple_notify_searchresults_get_columns_count(results);
+	purple_notify_searchresults_free(results);
+
+	return sr;
+}
+
+/* Takes @n strings, which must be one for each column; any may be NULL */
+void chime_sr_add_row(struct chime_sr *sr, const gchar *const *cols, guint n)
+{
+	gchar **row;
+	guint i;
+
+	g_return_if_fail(sr->building);
+	g_return_if_fail(n == sr->ncols);
+
+	row = g_new0(gchar *, n + 1);
+	for (i = 0; i < n; i++)
+		row[i] = g_strdup(cols[i] ? cols[i] : "");
+
+	g_ptr_array_add(sr->building, row);
+}
+
+static GPtrArray *build_rows(struct chime_sr *sr)
+{
+	sr->building = g_ptr_array_new_with_free_func((GDestroyNotify)g_strfreev);
+	sr->rows(sr, sr->data);
+
+	GPtrArray *rows = sr->building;
+	sr->building = NULL;
+	return rows;
+}
+
+static gboolean rows_equal(GPtrArray *a, GPtrArray *b)
+{
+	guint i;
+
+	if (a->len != b->len)
+		return FALSE;
+
+	for (i = 0; i < a->len; i++) {
+		gchar **ra = a->pdata[i], **rb = b->pdata[i];
+
+		while (*ra && *rb && !strcmp(*ra, *rb)) {
+			ra++;
+			rb++;
+		}
+		if (*ra || *rb)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static PurpleNotifySearchResults *make_results(struct chime_sr *sr)
+{
+	PurpleNotifySearchResults *results = purple_notify_searchresults_new();
+	guint i;
+
+	sr->columns(results);
+
+	for (i = 0; i < sr->shown->len; i++) {
+		gchar **col;
+		GList *row = NULL;
+
+		for (col = sr->shown->pdata[i]; *col; col++)
+			row = g_list_append(row, g_strdup(*col));
+
+		purple_notify_searchresults_row_add(results, row);
+	}
+	return results;
+}
+
+void *chime_sr_show(struct chime_sr *sr, const char *title, const char *primary,
+		    const char *secondary, PurpleNotifyCloseCallback cb, gpointer user_data)
+{
+	if (sr->shown)
+		g_ptr_array_unref(sr->shown);
+	sr->shown = build_rows(sr);
+	sr->last_shown = g_get_monotonic_time();
+
+	sr->ui_handle = purple_notify_searchresults(sr->conn, title, primary, secondary,
+						    make_results(sr), cb, user_data);
+	return sr->ui_handle;
+}
+
+static gboolean do_refresh(gpointer _sr)
+{
+	struct chime_sr *sr = _sr;
+
+	sr->refresh_id = 0;
+
+	GPtrArray *rows = build_rows(sr);
+	if (sr->shown && rows_equal(sr->shown, rows)) {
+		g_ptr_array_unref(rows);
+		return FALSE;
+	}
+
+	if (sr->shown)
+		g_ptr_array_unref(sr->shown);
+	sr->shown = rows;
+	sr->last_shown = g_get_monotonic_time();
+
+	purple_notify_searchresults_new_rows(sr->conn, make_results(sr), sr->ui_handle);
+	return FALSE;
+}
+
+void chime_sr_refresh(struct chime_sr *sr)
+{
+	if (!sr->ui_handle || sr->refresh_id)
+		return;
+
+	gint64 since = (g_get_monotonic_time() - sr->last_shown) / 1000;
+
+	/* Gather up anything else that happens in the same main loop
+	 * iteration, and don't redraw more often than the interval. */
+	if (since >= SR_REFRESH_INTERVAL)
+		sr->refresh_id = g_idle_add(do_refresh, sr);
+	else
+		sr->refresh_id = g_timeout_add(SR_REFRESH_INTERVAL - since, do_refresh, sr);
+}
+
+/* The close callback passed to chime_sr_show() will be invoked, and is
+ * expected to free @sr. */
+void chime_sr_close(struct chime_sr *sr)
+{
+	if (sr->ui_handle)
+		purple_notify_close(PURPLE_NOTIFY_SEARCHRESULTS, sr->ui_handle);
+}
+
+void chime_sr_free(struct chime_sr *sr)
+{
+	if (sr->refresh_id)
+		g_source_remove(sr->refresh_id);
+	if (sr->shown)
+		g_ptr_array_unref(sr->shown);
+	g_free(sr);
+}